@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <utils/SystemClock.h>
+#include <log/log.h>
+#include <android-base/file.h>
+#include <android-base/strings.h>
+
+#include "CanBus.h"
+#include "LatencyStats.h"
+#include "Trace.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static constexpr std::chrono::seconds kStatsPeriod {30};
+static constexpr size_t kTxMaxQueued = 256;
+static constexpr std::chrono::milliseconds kTxMinBackoff {1};
+static constexpr std::chrono::milliseconds kTxMaxBackoff {64};
+static constexpr std::chrono::milliseconds kTxBurst {10};     // of the bus load budget
+
+/* Worst case length of a frame on the wire, stuff bits included, at the nominal bit rate. */
+static uint32_t canFrameBits(canid_t canId, size_t length)
+{
+    const uint32_t dataBits = 8 * length;
+
+    if (canId & CAN_EFF_FLAG) {
+        return 67 + dataBits + (54 + dataBits - 1) / 4;
+    }
+    return 47 + dataBits + (34 + dataBits - 1) / 4;
+}
+
+CanBus::CanBus(const std::string& name, const VehicleHalConfig& config) :
+    mName(name),
+    mConfig(config),
+    mSocket(socket(PF_CAN, SOCK_RAW, CAN_RAW)),
+    mCanFd(false),
+    mAdopted(false),
+    mEventLoop(nullptr),
+    mRxPending(0),
+    mRxFlushTimer(-1),
+    mTxDepth(0),
+    mTxBudget(double(config.canBitrate) * config.canTxBusShare / 100.0),
+    mTxTokens(canFrameBits(CAN_EFF_FLAG, CANFD_MAX_DLEN)),
+    mTxRefilled(std::chrono::steady_clock::now()),
+    mTxEvent(-1),
+    mTxRetryTimer(-1),
+    mTxBackoff(kTxMinBackoff)
+{
+    if (mSocket < 0) {
+        ALOGE("CAN RAW socket for %s is NOT created.", mName.c_str());
+    }
+}
+
+CanBus::~CanBus(void)
+{
+    if (mSocket != -1) {
+        logStats();
+        close(mSocket);
+    }
+    if (mRxFlushTimer != -1) {
+        close(mRxFlushTimer);
+    }
+    if (mTxEvent != -1) {
+        close(mTxEvent);
+    }
+    if (mTxRetryTimer != -1) {
+        close(mTxRetryTimer);
+    }
+}
+
+bool CanBus::open(const std::vector<struct can_filter>& filters)
+{
+    if (mSocket == -1) {
+        return false;
+    }
+    if (mAdopted) {
+        ALOGI("CAN RAW: %s stood in by SOCKET=%d", mName.c_str(), mSocket);
+        return true;
+    }
+
+    // Configure the socket before bind(), so no unfiltered frame gets queued.
+    const int enable = 1;
+    if (setsockopt(mSocket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0) {
+        ALOGW("SO_RXQ_OVFL is not supported (error %d)", errno);
+    }
+
+    enableRxTimestamps();
+
+    if (mConfig.canRxFilter) {
+        installRxFilter(filters);
+    }
+
+    struct ifreq ifr;
+    std::memset(&ifr.ifr_name, 0, sizeof(ifr.ifr_name));
+    std::strncpy(ifr.ifr_name, mName.c_str(), IFNAMSIZ - 1);
+
+    if (ioctl(mSocket, SIOCGIFINDEX, &ifr) < 0) {
+        ALOGE("ioctl SIOCGIFINDEX for %s failed (error %d)", mName.c_str(), errno);
+        close(mSocket);
+        mSocket = -1;
+        return false;
+    }
+
+    struct sockaddr_can addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+
+    if (mConfig.canFd) {
+        enableFd(ifr);
+    }
+
+    if (bind(mSocket, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ALOGE("bind CAN socket to %s failed (error %d)", mName.c_str(), errno);
+        close(mSocket);
+        mSocket = -1;
+        return false;
+    }
+
+    ALOGI("CAN RAW: IFACE=%s, IFINDEX=%d, SOCKET=%d\n", ifr.ifr_name, ifr.ifr_ifindex, mSocket);
+    return true;
+}
+
+void CanBus::adoptSocket(int socket)
+{
+    if (mSocket != -1) {
+        close(mSocket);
+    }
+    mSocket = socket;
+    mAdopted = true;
+}
+
+bool CanBus::attach(EventLoop& loop, FrameHandler onFrame, BatchHandler onBatch)
+{
+    if (mSocket == -1) {
+        return false;
+    }
+
+    mEventLoop = &loop;
+    mOnFrame = std::move(onFrame);
+    mOnBatch = std::move(onBatch);
+
+    mRxSlots.resize(mConfig.canRxBatchSize);
+    mRxMsgs.resize(mConfig.canRxBatchSize);
+    for (size_t i = 0; i < mRxSlots.size(); i++) {
+        resetRxSlot(i);
+    }
+    mStatsLogged = std::chrono::steady_clock::now();
+
+    if (mConfig.canRxBatchLatency.count() != 0) {
+        mRxFlushTimer = loop.addTimer(std::bind(&CanBus::flush, this));
+    }
+    mTxRetryTimer = loop.addTimer(std::bind(&CanBus::drainTx, this));
+    mTxEvent = loop.addEvent(std::bind(&CanBus::drainTx, this));
+
+    return loop.addFd(mSocket, EPOLLIN, [this](uint32_t) { onReadable(); });
+}
+
+void CanBus::enableFd(struct ifreq& ifr)
+{
+    // Only interfaces configured with "fd on" report the CAN FD MTU.
+    if (ioctl(mSocket, SIOCGIFMTU, &ifr) < 0) {
+        ALOGW("ioctl SIOCGIFMTU failed (error %d), using classic CAN", errno);
+        return;
+    }
+    if (ifr.ifr_mtu != CANFD_MTU) {
+        ALOGI("CAN RAW: %s is classic CAN (MTU %d)", ifr.ifr_name, ifr.ifr_mtu);
+        return;
+    }
+
+    const int enable = 1;
+    if (setsockopt(mSocket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+        ALOGW("CAN_RAW_FD_FRAMES is not supported (error %d), using classic CAN", errno);
+        return;
+    }
+
+    mCanFd = true;
+    ALOGI("CAN RAW: %s is CAN FD", ifr.ifr_name);
+}
+
+void CanBus::enableRxTimestamps(void)
+{
+    const int flags = mConfig.canRxHwTimestamps
+            ? (SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE)
+            : (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE);
+
+    if (setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        ALOGI("CAN RAW: %s %s RX timestamps", mName.c_str(),
+              mConfig.canRxHwTimestamps ? "hardware" : "kernel");
+        return;
+    }
+    ALOGW("SO_TIMESTAMPING is not supported (error %d)", errno);
+
+    const int enable = 1;
+    if (setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0) {
+        ALOGI("CAN RAW: %s kernel RX timestamps (SO_TIMESTAMPNS)", mName.c_str());
+        return;
+    }
+    ALOGW("SO_TIMESTAMPNS is not supported (error %d), RX is stamped on reception", errno);
+}
+
+void CanBus::installRxFilter(const std::vector<struct can_filter>& filters)
+{
+    if (filters.size() > CAN_RAW_FILTER_MAX) {
+        ALOGW("%zu CAN IDs exceed CAN_RAW_FILTER_MAX, filtering in userspace only", filters.size());
+        return;
+    }
+
+    // An empty filter list makes the socket receive nothing, which is what
+    // a TX only bus wants.
+    if (setsockopt(mSocket, SOL_CAN_RAW, CAN_RAW_FILTER,
+                   filters.data(), filters.size() * sizeof(struct can_filter)) < 0) {
+        ALOGE("setsockopt CAN_RAW_FILTER failed (error %d)", errno);
+        return;
+    }
+
+    ALOGI("CAN RAW: %s %zu RX filters installed", mName.c_str(), filters.size());
+}
+
+void CanBus::logStats(void)
+{
+    // Frames the interface received but the kernel filter kept out of the socket
+    // are the interface total minus the frames that reached us.
+    uint64_t ifaceFrames = 0;
+    std::string sysfsValue;
+    if (android::base::ReadFileToString("/sys/class/net/" + mName + "/statistics/rx_packets",
+                                        &sysfsValue)) {
+        ifaceFrames = std::strtoull(android::base::Trim(sysfsValue).c_str(), NULL, 10);
+    }
+
+    uint64_t received = mStats.received;
+    uint64_t latencyCount = mStats.txLatencyCount;
+    ALOGI("CAN %s: RX iface %" PRIu64 ", filtered by kernel ~%" PRIu64 ", received %" PRIu64
+          " (%" PRIu64 " bytes), accepted %" PRIu64 ", dropped %" PRIu64 ", queue overflows %u"
+          ", unchanged suppressed %" PRIu64 ", dispatch backlog lost %" PRIu64 "; TX sent %" PRIu64 " (%" PRIu64 " bytes), errors %" PRIu64,
+          mName.c_str(), ifaceFrames, (ifaceFrames > received) ? ifaceFrames - received : 0,
+          received, uint64_t(mStats.receivedBytes), uint64_t(mStats.accepted),
+          uint64_t(mStats.dropped), uint32_t(mStats.overflows), uint64_t(mStats.suppressed),
+          uint64_t(mStats.backlogged),
+          uint64_t(mStats.sent), uint64_t(mStats.sentBytes), uint64_t(mStats.sendErrors));
+
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lock(mTxLock);
+        depth = mTxDepth;
+    }
+    ALOGI("CAN %s: TX queue depth %zu (max %u), queued %" PRIu64 ", coalesced %" PRIu64
+          ", queue full %" PRIu64 ", backpressure %" PRIu64 ", rate limited %" PRIu64
+          ", throttled %" PRIu64 ", latency avg %" PRIu64
+          " us, max %" PRIu64 " us",
+          mName.c_str(), depth, uint32_t(mStats.txDepthMax), uint64_t(mStats.txQueued),
+          uint64_t(mStats.txCoalesced), uint64_t(mStats.txQueueFull),
+          uint64_t(mStats.txBackpressure), uint64_t(mStats.txRateLimited),
+          uint64_t(mStats.txThrottled),
+          (latencyCount != 0) ? uint64_t(mStats.txLatencySumUs) / latencyCount : 0,
+          uint64_t(mStats.txLatencyMaxUs));
+}
+
+int64_t CanBus::readRxCmsg(const struct msghdr& hdr, int64_t realtimeToElapsed)
+{
+    int64_t timestamp = 0;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL;
+            cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&hdr), cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+
+        if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+            struct scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            // ts[0] is the kernel software stamp, ts[2] the raw controller clock.
+            const struct timespec& ts = mConfig.canRxHwTimestamps ? stamps.ts[2] : stamps.ts[0];
+            timestamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        } else if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+            struct timespec ts;
+            std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            timestamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        } else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+            // Cumulative drop counter of the socket, sent with every frame.
+            __u32 overflows;
+            std::memcpy(&overflows, CMSG_DATA(cmsg), sizeof(overflows));
+            mStats.overflows = overflows;
+        }
+    }
+
+    // Kernel stamps are CLOCK_REALTIME, HAL events use elapsedRealtime.
+    return (timestamp != 0) ? timestamp + realtimeToElapsed : 0;
+}
+
+void CanBus::resetRxSlot(size_t i)
+{
+    RxSlot& slot = mRxSlots[i];
+    slot.iov.iov_base = &slot.frame;
+    slot.iov.iov_len = sizeof(slot.frame);
+
+    struct msghdr& hdr = mRxMsgs[i].msg_hdr;
+    hdr.msg_name = &slot.addr;
+    hdr.msg_namelen = sizeof(slot.addr);
+    hdr.msg_iov = &slot.iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &slot.ctrlmsg;
+    hdr.msg_controllen = sizeof(slot.ctrlmsg);
+    hdr.msg_flags = 0;
+}
+
+void CanBus::onReadable(void)
+{
+    const size_t batchSize = mRxMsgs.size();
+    int frames = recvmmsg(mSocket, &mRxMsgs[mRxPending], batchSize - mRxPending,
+                          MSG_DONTWAIT, NULL);
+
+    if (frames < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (errno == ENETDOWN) {
+            ALOGE("CAN interface %s is down", mName.c_str());
+            return;
+        }
+
+        ALOGE("CAN socket %s read error %d", mName.c_str(), errno);
+        mEventLoop->removeFd(mSocket);
+        return;
+    }
+
+    const bool batchStarted = (mRxPending == 0);
+    mRxPending += frames;
+
+    if (mRxPending == batchSize || mRxFlushTimer == -1) {
+        flush();
+    } else if (batchStarted) {
+        // Give a busy bus a chance to fill the batch, but do not hold
+        // the frames already received longer than the configured latency.
+        EventLoop::armTimer(mRxFlushTimer, mConfig.canRxBatchLatency);
+    }
+}
+
+void CanBus::flush(void)
+{
+    if (mRxPending == 0) {
+        return;
+    }
+    if (mRxFlushTimer != -1) {
+        EventLoop::armTimer(mRxFlushTimer, std::chrono::nanoseconds(0));
+    }
+
+    mStats.received += mRxPending;
+
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    const int64_t receivedAt = elapsedRealtimeNano();
+    const int64_t realtimeToElapsed = receivedAt -
+            (realtime.tv_sec * 1000000000LL + realtime.tv_nsec);
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < mRxPending; i++) {
+        int64_t timestamp = readRxCmsg(mRxMsgs[i].msg_hdr, realtimeToElapsed);
+        if (timestamp <= 0 || timestamp > receivedAt) {
+            timestamp = receivedAt;     // No stamp, or the wall clock was stepped
+        }
+
+        const struct canfd_frame& frame = mRxSlots[i].frame;
+        bytes += frame.len;
+        mOnFrame(*this, frame, mRxMsgs[i].msg_len, timestamp);
+        resetRxSlot(i);
+    }
+    mStats.receivedBytes += bytes;
+    mRxPending = 0;
+
+    mOnBatch();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - mStatsLogged >= kStatsPeriod) {
+        logStats();
+        mStatsLogged = now;
+    }
+}
+
+int CanBus::transmit(canid_t canId, const void* bytesPtr, size_t bytesCount, int flags)
+{
+    struct canfd_frame frame = {
+        .can_id = canId,
+        .len = CAN_MAX_DLEN
+    };
+    size_t mtu = CAN_MTU;
+
+    if (mCanFd && bytesCount > CAN_MAX_DLEN) {
+        frame.len = CANFD_MAX_DLEN;
+        frame.flags = CANFD_BRS;
+        mtu = CANFD_MTU;
+    }
+
+    if (frame.len > bytesCount){
+        frame.len = bytesCount;
+    }
+
+    std::memcpy(&frame.data, bytesPtr, frame.len);
+
+    if (::send(mSocket, &frame, mtu, flags) < 0) {
+        return errno;
+    }
+
+    mStats.sent++;
+    mStats.sentBytes += frame.len;
+    VHAL_TRACE(CAN_TX, canId, frame.len, 0, 0);
+    return 0;
+}
+
+bool CanBus::send(canid_t canId, const void* bytesPtr, size_t bytesCount)
+{
+    if (mSocket == -1) {
+        return false;
+    }
+
+    // Callers run on the event loop and dispatch threads, which must not block.
+    int error = transmit(canId, bytesPtr, bytesCount, MSG_DONTWAIT);
+    if (error == ENOBUFS || error == EAGAIN) {
+        // Left to the caller to retry, see IsoTpSender::poll().
+        mStats.txBackpressure++;
+        errno = error;
+        return false;
+    }
+    if (error != 0) {
+        mStats.sendErrors++;
+        ALOGE("Send %zu bytes to %s failed, error %d", bytesCount, mName.c_str(), error);
+        errno = error;
+        return false;
+    }
+
+    // Direct sends (ISO-TP) are not scheduled, but still use up the budget.
+    if (mTxBudget != 0.0) {
+        std::lock_guard<std::mutex> lock(mTxLock);
+        mTxTokens -= canFrameBits(canId, bytesCount);
+    }
+    return true;
+}
+
+bool CanBus::queue(uint64_t key, canid_t canId, const void* bytesPtr, size_t bytesCount,
+                   const CanTxPolicy& policy)
+{
+    if (mTxEvent == -1) {
+        return false;
+    }
+
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(mTxLock);
+
+        auto it = mTxPending.find(key);
+        if (it != mTxPending.end()) {
+            // Keep the queue position, so a value that keeps changing is not starved.
+            TxEntry& entry = it->second;
+            entry.canId = canId;
+            entry.length = std::min(bytesCount, sizeof(entry.data));
+            std::memcpy(entry.data, bytesPtr, entry.length);
+            mStats.txQueued++;
+            mStats.txCoalesced++;
+            return true;
+        }
+
+        if (mTxDepth == kTxMaxQueued) {
+            mStats.txQueueFull++;
+            ALOGW("CAN %s TX queue is full, frame 0x%x is not sent", mName.c_str(), canId);
+            return false;
+        }
+
+        TxEntry& entry = mTxPending[key];
+        entry.canId = canId;
+        entry.length = std::min(bytesCount, sizeof(entry.data));
+        std::memcpy(entry.data, bytesPtr, entry.length);
+        entry.policy = policy;
+        entry.queuedAt = std::chrono::steady_clock::now();
+        mTxOrder[static_cast<size_t>(policy.priority)].push_back(key);
+        mTxDepth++;
+
+        notify = (mTxDepth == 1);
+        if (mTxDepth > mStats.txDepthMax) {
+            mStats.txDepthMax = mTxDepth;
+        }
+    }
+    mStats.txQueued++;
+
+    // The loop drains until the queue is empty, one wakeup per non-empty period is enough.
+    if (notify) {
+        EventLoop::notify(mTxEvent);
+    }
+    return true;
+}
+
+void CanBus::refillTxTokens(std::chrono::steady_clock::time_point now)
+{
+    const double burst = mTxBudget * std::chrono::duration<double>(kTxBurst).count();
+    const double elapsed = std::chrono::duration<double>(now - mTxRefilled).count();
+
+    // Allow at least one frame of the largest size, however small the budget.
+    mTxTokens = std::min(mTxTokens + elapsed * mTxBudget,
+                         std::max(burst, double(canFrameBits(CAN_EFF_FLAG, CANFD_MAX_DLEN))));
+    mTxRefilled = now;
+}
+
+bool CanBus::takeTxEntry(std::chrono::steady_clock::time_point now, uint64_t* key, TxEntry* entry,
+                         std::chrono::nanoseconds* retry)
+{
+    auto earliest = std::chrono::steady_clock::time_point::max();
+
+    // Highest priority first; within a class, the oldest frame whose
+    // minimum interval has passed.
+    for (auto& order : mTxOrder) {
+        for (auto it = order.begin(); it != order.end(); ++it) {
+            const TxEntry& pending = mTxPending.find(*it)->second;
+
+            auto lastSent = mTxLastSent.find(*it);
+            if (lastSent != mTxLastSent.end() && pending.policy.minInterval.count() != 0) {
+                auto notBefore = lastSent->second + pending.policy.minInterval;
+                if (now < notBefore) {
+                    earliest = std::min(earliest, notBefore);
+                    continue;
+                }
+            }
+
+            const uint32_t bits = canFrameBits(pending.canId, pending.length);
+            if (mTxBudget != 0.0 && mTxTokens < bits) {
+                // Do not let lower priority frames overtake a throttled one.
+                // Round up: a retry truncated to zero would never arm the timer.
+                *retry = std::chrono::ceil<std::chrono::nanoseconds>(
+                        std::chrono::duration<double>((bits - mTxTokens) / mTxBudget));
+                mStats.txThrottled++;
+                return false;
+            }
+
+            *key = *it;
+            *entry = pending;
+            mTxPending.erase(*it);
+            order.erase(it);
+            mTxDepth--;
+            if (mTxBudget != 0.0) {
+                mTxTokens -= bits;
+            }
+            return true;
+        }
+    }
+
+    if (earliest != std::chrono::steady_clock::time_point::max()) {
+        *retry = earliest - now;
+        mStats.txRateLimited++;
+    }
+    return false;
+}
+
+void CanBus::drainTx(void)
+{
+    for (;;) {
+        uint64_t key;
+        TxEntry entry;
+        std::chrono::nanoseconds retry {0};
+        auto now = std::chrono::steady_clock::now();
+        bool taken;
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(mTxLock);
+            if (mTxBudget != 0.0) {
+                refillTxTokens(now);
+            }
+            taken = takeTxEntry(now, &key, &entry, &retry);
+            pending = (mTxDepth != 0);
+        }
+
+        if (!taken) {
+            // Nothing else wakes the loop for frames left behind, and a
+            // zero delay would disarm the timer.
+            if (pending) {
+                EventLoop::armTimer(mTxRetryTimer, std::max(retry, std::chrono::nanoseconds(1)));
+            }
+            return;
+        }
+
+        int error = transmit(entry.canId, entry.data, entry.length, MSG_DONTWAIT);
+
+        if (error == ENOBUFS || error == EAGAIN) {
+            // The controller queue is full. Raw CAN sockets do not signal
+            // EPOLLOUT for that, so retry after a growing delay.
+            {
+                std::lock_guard<std::mutex> lock(mTxLock);
+                if (mTxPending.emplace(key, entry).second) {
+                    mTxOrder[static_cast<size_t>(entry.policy.priority)].push_front(key);
+                    mTxDepth++;
+                }   // else a newer value was queued meanwhile and replaces this one
+                if (mTxBudget != 0.0) {
+                    mTxTokens += canFrameBits(entry.canId, entry.length);
+                }
+            }
+            mStats.txBackpressure++;
+            EventLoop::armTimer(mTxRetryTimer, mTxBackoff);
+            mTxBackoff = std::min(mTxBackoff * 2, kTxMaxBackoff);
+            return;
+        }
+        mTxBackoff = kTxMinBackoff;
+
+        if (error != 0) {
+            mStats.sendErrors++;
+            ALOGE("Send %zu bytes to %s failed, error %d", entry.length, mName.c_str(), error);
+            continue;
+        }
+
+        if (entry.policy.minInterval.count() != 0) {
+            std::lock_guard<std::mutex> lock(mTxLock);
+            mTxLastSent[key] = now;
+        }
+
+        LatencyStats::record(LatencyStage::CAN_TX, entry.canId, entry.queuedAt);
+        const uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - entry.queuedAt).count();
+        mStats.txLatencyCount++;
+        mStats.txLatencySumUs += latency;
+        if (latency > mStats.txLatencyMaxUs) {
+            mStats.txLatencyMaxUs = latency;
+        }
+    }
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CanBus_H_
+#define _CanBus_H_
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <net/if.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "EventLoop.h"
+#include "VehicleHalConfig.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * One SocketCAN interface: a raw socket with its own filter set, batched
+ * reception and queued transmission on the HAL event loop, and per-bus
+ * traffic counters. send() and queue() may be called from any thread.
+ */
+class CanBus {
+public:
+    struct Stats {
+        std::atomic<uint64_t>   received {0};   // frames that passed the kernel filter
+        std::atomic<uint64_t>   receivedBytes {0};
+        std::atomic<uint64_t>   accepted {0};   // frames addressing a known property
+        std::atomic<uint64_t>   dropped {0};    // frames discarded in userspace
+        std::atomic<uint64_t>   suppressed {0}; // ON_CHANGE values received unchanged
+        std::atomic<uint32_t>   overflows {0};  // frames lost on socket queue overflow
+        std::atomic<uint64_t>   backlogged {0}; // frames lost because dispatch fell behind
+        std::atomic<uint64_t>   sent {0};
+        std::atomic<uint64_t>   sentBytes {0};
+        std::atomic<uint64_t>   sendErrors {0};
+        std::atomic<uint64_t>   txQueued {0};       // frames accepted by queue()
+        std::atomic<uint64_t>   txCoalesced {0};    // pending frames replaced by a newer value
+        std::atomic<uint64_t>   txQueueFull {0};    // frames refused by a full queue
+        std::atomic<uint64_t>   txBackpressure {0}; // sends deferred on ENOBUFS/EAGAIN
+        std::atomic<uint64_t>   txRateLimited {0};  // waits for a minimum interval to pass
+        std::atomic<uint64_t>   txThrottled {0};    // waits for the bus load budget
+        std::atomic<uint32_t>   txDepthMax {0};
+        std::atomic<uint64_t>   txLatencyCount {0}; // queued frames sent
+        std::atomic<uint64_t>   txLatencySumUs {0}; // queue() to send, of those frames
+        std::atomic<uint64_t>   txLatencyMaxUs {0};
+    };
+
+    using FrameHandler = std::function<void(CanBus& bus, const struct canfd_frame& frame,
+                                            size_t mtu, int64_t timestamp)>;
+    /* Called once all frames of a received batch were handled. */
+    using BatchHandler = std::function<void(void)>;
+
+    CanBus(const std::string& name, const VehicleHalConfig& config);
+    ~CanBus(void);
+
+    bool open(const std::vector<struct can_filter>& filters);
+    /*
+     * Takes a connected socket in place of the interface, before open(), which
+     * then keeps it as is. Lets benchmarks stand one end of a socketpair in
+     * for the bus and still run the whole TX path.
+     */
+    void adoptSocket(int socket);
+    bool attach(EventLoop& loop, FrameHandler onFrame, BatchHandler onBatch);
+    /* Sends a frame right away. On failure errno tells a full TX queue (ENOBUFS, EAGAIN) apart. */
+    bool send(canid_t canId, const void* bytesPtr, size_t bytesCount);
+    /*
+     * Queues a frame for the event loop to send. A frame still pending under
+     * the same key is replaced, so only the latest value goes out. Frames go
+     * out by priority, no sooner than policy.minInterval after the previous
+     * frame of the key, and within the bus load budget.
+     */
+    bool queue(uint64_t key, canid_t canId, const void* bytesPtr, size_t bytesCount,
+               const CanTxPolicy& policy = CanTxPolicy());
+
+    const std::string& name(void) const { return mName; }
+    bool isOpen(void) const { return mSocket != -1; }
+    bool isFd(void) const { return mCanFd; }
+    Stats& stats(void) { return mStats; }
+    const Stats& stats(void) const { return mStats; }
+    void logStats(void);
+
+private:
+    struct RxSlot {
+        struct canfd_frame  frame;
+        struct sockaddr_can addr;
+        struct iovec        iov;
+        char                ctrlmsg[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+                                    CMSG_SPACE(sizeof(__u32))];
+    };
+
+    void enableFd(struct ifreq& ifr);
+    void enableRxTimestamps(void);
+    void installRxFilter(const std::vector<struct can_filter>& filters);
+    int64_t readRxCmsg(const struct msghdr& hdr, int64_t realtimeToElapsed);
+    void resetRxSlot(size_t i);
+    struct TxEntry {
+        canid_t             canId;
+        size_t              length;
+        uint8_t             data[CANFD_MAX_DLEN];
+        CanTxPolicy         policy;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    void onReadable(void);
+    void flush(void);
+    int transmit(canid_t canId, const void* bytesPtr, size_t bytesCount, int flags);
+    void drainTx(void);
+    bool takeTxEntry(std::chrono::steady_clock::time_point now, uint64_t* key, TxEntry* entry,
+                     std::chrono::nanoseconds* retry);
+    void refillTxTokens(std::chrono::steady_clock::time_point now);
+
+    const std::string               mName;
+    const VehicleHalConfig          mConfig;
+    int                             mSocket;
+    bool                            mCanFd;
+    bool                            mAdopted;
+    Stats                           mStats;
+    EventLoop*                      mEventLoop;
+    FrameHandler                    mOnFrame;
+    BatchHandler                    mOnBatch;
+    std::vector<RxSlot>             mRxSlots;
+    std::vector<struct mmsghdr>     mRxMsgs;
+    size_t                          mRxPending;
+    int                             mRxFlushTimer;
+    std::chrono::steady_clock::time_point mStatsLogged;
+    std::mutex                      mTxLock;
+    std::unordered_map<uint64_t, TxEntry> mTxPending;  // key -> latest frame
+    std::deque<uint64_t>            mTxOrder[kCanTxPriorities]; // keys in the order first queued
+    size_t                          mTxDepth;
+    std::unordered_map<uint64_t, std::chrono::steady_clock::time_point> mTxLastSent;
+    const double                    mTxBudget;          // bits per second, 0 - unlimited
+    double                          mTxTokens;          // bits that may be sent now
+    std::chrono::steady_clock::time_point mTxRefilled;
+    int                             mTxEvent;
+    int                             mTxRetryTimer;
+    std::chrono::milliseconds       mTxBackoff;         // loop thread only
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _CanBus_H_
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "CanProtocol.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static size_t canFdPaddedLength(size_t length)
+{
+    static constexpr size_t kValidLengths[] = {8, 12, 16, 20, 24, 32, 48, 64};
+
+    for (size_t valid : kValidLengths) {
+        if (length <= valid) {
+            return valid;
+        }
+    }
+    return 0;
+}
+
+template <typename T>
+static size_t packElements(const hidl_vec<T>& values, VhalCanValueType type, vhal_canfd_msg_t* msg)
+{
+    const size_t bytes = values.size() * sizeof(T);
+    if (bytes > kVhalCanFdDataSize) {
+        return 0;
+    }
+
+    msg->valueType = static_cast<uint8_t>(type);
+    msg->count = static_cast<uint8_t>(values.size());
+    std::memcpy(msg->data, values.data(), bytes);
+    return bytes;
+}
+
+template <typename T>
+static bool unpackElements(const vhal_canfd_msg_t& msg, size_t dataLength, hidl_vec<T>* values)
+{
+    const size_t bytes = msg.count * sizeof(T);
+    if (bytes > dataLength) {
+        return false;
+    }
+
+    values->resize(msg.count);
+    std::memcpy(values->data(), msg.data, bytes);
+    return true;
+}
+
+/* Whether a value of type can be stored in prop, MIXED properties take any of them. */
+static bool isValueTypeOf(VhalCanValueType type, int32_t prop)
+{
+    switch (getPropType(prop)) {
+        case VehiclePropertyType::BOOLEAN:
+        case VehiclePropertyType::INT32:
+        case VehiclePropertyType::INT32_VEC:
+            return type == VhalCanValueType::INT32;
+        case VehiclePropertyType::FLOAT:
+        case VehiclePropertyType::FLOAT_VEC:
+            return type == VhalCanValueType::FLOAT;
+        case VehiclePropertyType::INT64:
+        case VehiclePropertyType::INT64_VEC:
+            return type == VhalCanValueType::INT64;
+        case VehiclePropertyType::BYTES:
+            return type == VhalCanValueType::BYTES;
+        case VehiclePropertyType::STRING:
+            return type == VhalCanValueType::STRING;
+        case VehiclePropertyType::MIXED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t encodeCanFdMessage(const VehiclePropValue& propValue, vhal_canfd_msg_t* msg)
+{
+    std::memset(msg, 0, sizeof(*msg));
+    msg->propId = propValue.prop;
+    msg->areaId = propValue.areaId;
+
+    const auto& value = propValue.value;
+    size_t bytes = 0;
+
+    if (value.int32Values.size() != 0) {
+        bytes = packElements(value.int32Values, VhalCanValueType::INT32, msg);
+    } else if (value.floatValues.size() != 0) {
+        bytes = packElements(value.floatValues, VhalCanValueType::FLOAT, msg);
+    } else if (value.int64Values.size() != 0) {
+        bytes = packElements(value.int64Values, VhalCanValueType::INT64, msg);
+    } else if (value.bytes.size() != 0) {
+        bytes = packElements(value.bytes, VhalCanValueType::BYTES, msg);
+    } else if (value.stringValue.size() != 0) {
+        if (value.stringValue.size() > kVhalCanFdDataSize) {
+            return 0;
+        }
+        bytes = value.stringValue.size();
+        msg->valueType = static_cast<uint8_t>(VhalCanValueType::STRING);
+        msg->count = static_cast<uint8_t>(bytes);
+        std::memcpy(msg->data, value.stringValue.c_str(), bytes);
+    } else {
+        return 0;
+    }
+
+    return (bytes != 0) ? canFdPaddedLength(kVhalCanFdHeaderSize + bytes) : 0;
+}
+
+bool decodeCanFdMessage(const vhal_canfd_msg_t& msg, size_t length, VehiclePropValue* propValue)
+{
+    if (length < kVhalCanFdHeaderSize) {
+        return false;
+    }
+
+    // A sender disagreeing on the type would fill a value array the property does not use.
+    const auto type = static_cast<VhalCanValueType>(msg.valueType);
+    if (!isValueTypeOf(type, msg.propId)) {
+        return false;
+    }
+
+    const size_t dataLength = length - kVhalCanFdHeaderSize;
+    auto& value = propValue->value;
+
+    switch (type) {
+        case VhalCanValueType::INT32:
+            return unpackElements(msg, dataLength, &value.int32Values);
+        case VhalCanValueType::FLOAT:
+            return unpackElements(msg, dataLength, &value.floatValues);
+        case VhalCanValueType::INT64:
+            return unpackElements(msg, dataLength, &value.int64Values);
+        case VhalCanValueType::BYTES:
+            return unpackElements(msg, dataLength, &value.bytes);
+        case VhalCanValueType::STRING:
+            if (msg.count > dataLength) {
+                return false;
+            }
+            value.stringValue = std::string(reinterpret_cast<const char*>(msg.data), msg.count);
+            return true;
+        case VhalCanValueType::AREA_INT32:
+        case VhalCanValueType::AREA_FLOAT:
+            return false;   // See decodeCanFdAreas()
+    }
+
+    return false;
+}
+
+size_t encodeCanFdAreas(int32_t prop, bool isFloat, const vhal_canfd_area_value_t* values,
+                        size_t count, vhal_canfd_msg_t* msg)
+{
+    if (count == 0 || count > kVhalCanFdMaxAreas) {
+        return 0;
+    }
+
+    std::memset(msg, 0, sizeof(*msg));
+    msg->propId = prop;
+    msg->valueType = static_cast<uint8_t>(isFloat ? VhalCanValueType::AREA_FLOAT
+                                                  : VhalCanValueType::AREA_INT32);
+    msg->count = static_cast<uint8_t>(count);
+    std::memcpy(msg->data, values, count * sizeof(*values));
+
+    return canFdPaddedLength(kVhalCanFdHeaderSize + count * sizeof(*values));
+}
+
+size_t decodeCanFdAreas(const vhal_canfd_msg_t& msg, size_t length, vhal_canfd_area_value_t* values)
+{
+    if (length < kVhalCanFdHeaderSize || !isCanFdAreaMessage(msg) || msg.count > kVhalCanFdMaxAreas
+            || msg.count * sizeof(*values) > length - kVhalCanFdHeaderSize) {
+        return 0;
+    }
+
+    std::memcpy(values, msg.data, msg.count * sizeof(*values));
+    return msg.count;
+}
+
+template <typename T>
+static uint8_t* packArray(const hidl_vec<T>& values, uint8_t* out)
+{
+    std::memcpy(out, values.data(), values.size() * sizeof(T));
+    return out + values.size() * sizeof(T);
+}
+
+template <typename T>
+static const uint8_t* unpackArray(const uint8_t* in, size_t count, hidl_vec<T>* values)
+{
+    values->resize(count);
+    std::memcpy(values->data(), in, count * sizeof(T));
+    return in + count * sizeof(T);
+}
+
+size_t encodeIsoTpMessage(const VehiclePropValue& propValue, uint8_t* buffer, size_t capacity)
+{
+    const auto& value = propValue.value;
+    const size_t length = sizeof(vhal_isotp_msg_hdr_t) +
+            value.int32Values.size() * sizeof(int32_t) +
+            value.floatValues.size() * sizeof(float) +
+            value.int64Values.size() * sizeof(int64_t) +
+            value.bytes.size() + value.stringValue.size();
+
+    if (length > capacity || value.int32Values.size() > UINT16_MAX ||
+            value.floatValues.size() > UINT16_MAX || value.int64Values.size() > UINT16_MAX ||
+            value.bytes.size() > UINT16_MAX || value.stringValue.size() > UINT16_MAX) {
+        return 0;
+    }
+
+    const vhal_isotp_msg_hdr_t hdr = {
+        .propId = propValue.prop,
+        .areaId = propValue.areaId,
+        .int32Count = static_cast<uint16_t>(value.int32Values.size()),
+        .floatCount = static_cast<uint16_t>(value.floatValues.size()),
+        .int64Count = static_cast<uint16_t>(value.int64Values.size()),
+        .bytesCount = static_cast<uint16_t>(value.bytes.size()),
+        .stringLength = static_cast<uint16_t>(value.stringValue.size())
+    };
+    std::memcpy(buffer, &hdr, sizeof(hdr));
+
+    uint8_t* out = buffer + sizeof(hdr);
+    out = packArray(value.int32Values, out);
+    out = packArray(value.floatValues, out);
+    out = packArray(value.int64Values, out);
+    out = packArray(value.bytes, out);
+    std::memcpy(out, value.stringValue.c_str(), value.stringValue.size());
+
+    return length;
+}
+
+bool decodeIsoTpMessage(const uint8_t* buffer, size_t length, VehiclePropValue* propValue)
+{
+    vhal_isotp_msg_hdr_t hdr;
+    if (length < sizeof(hdr)) {
+        return false;
+    }
+    std::memcpy(&hdr, buffer, sizeof(hdr));
+
+    const size_t expected = sizeof(hdr) + hdr.int32Count * sizeof(int32_t) +
+            hdr.floatCount * sizeof(float) + hdr.int64Count * sizeof(int64_t) +
+            hdr.bytesCount + hdr.stringLength;
+    if (length != expected) {
+        return false;
+    }
+
+    auto& value = propValue->value;
+    const uint8_t* in = buffer + sizeof(hdr);
+    in = unpackArray(in, hdr.int32Count, &value.int32Values);
+    in = unpackArray(in, hdr.floatCount, &value.floatValues);
+    in = unpackArray(in, hdr.int64Count, &value.int64Values);
+    in = unpackArray(in, hdr.bytesCount, &value.bytes);
+    value.stringValue = std::string(reinterpret_cast<const char*>(in), hdr.stringLength);
+    return true;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
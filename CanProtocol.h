@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CanProtocol_H_
+#define _CanProtocol_H_
+
+#include <inttypes.h>
+
+#include <linux/can.h>
+
+#include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * Vehicle HAL messages are carried in extended (29-bit) frames:
+ *
+ *   bits 22..28 - kCanVhalIdBase marker
+ *   bits 17..21 - area index: 0 - the lowest area id of the property,
+ *                 n - the n-th area in the property declaration
+ *   bit  16     - property belongs to VehiclePropertyGroup::VENDOR
+ *   bits  0..15 - property id without group, type and area bits
+ *
+ * so every property has its own CAN ID and the kernel can filter them.
+ */
+constexpr canid_t kCanVhalIdBase = 0x10000000;
+constexpr canid_t kCanVhalIdMarkerMask = 0x1fc00000;
+constexpr canid_t kCanVhalVendorBit = 1u << 16;
+constexpr unsigned kCanVhalAreaShift = 17;
+constexpr canid_t kCanVhalAreaMask = 0x1fu << kCanVhalAreaShift;
+constexpr size_t kCanVhalMaxAreaIndex = 0x1f;
+constexpr int32_t kVehiclePropertyGroupVendor = 0x20000000;
+
+constexpr canid_t canIdForProperty(int32_t prop, size_t areaIndex = 0) {
+    return CAN_EFF_FLAG | kCanVhalIdBase |
+           (static_cast<canid_t>(areaIndex << kCanVhalAreaShift) & kCanVhalAreaMask) |
+           ((prop & kVehiclePropertyGroupVendor) ? kCanVhalVendorBit : 0) |
+           (static_cast<canid_t>(prop) & 0xffff);
+}
+
+constexpr size_t canIdAreaIndex(canid_t canId) {
+    return (canId & kCanVhalAreaMask) >> kCanVhalAreaShift;
+}
+
+/* Whether canId has the layout above, rather than being a vehicle bus message. */
+constexpr bool isVhalCanId(canid_t canId) {
+    return (canId & CAN_EFF_FLAG) && (canId & kCanVhalIdMarkerMask) == kCanVhalIdBase;
+}
+
+/* Classic CAN: the first int32/float element of the value, truncated to int32. */
+typedef struct __attribute__((packed, aligned(2))) vhal_can_msg_s {
+    int32_t     propId;
+    int32_t     propValue;
+} vhal_can_msg_t;
+
+/* CAN FD: one whole value array of a (prop, area) pair. */
+enum class VhalCanValueType : uint8_t {
+    INT32 = 1,
+    FLOAT = 2,
+    INT64 = 3,
+    BYTES = 4,
+    STRING = 5,
+    AREA_INT32 = 6,     // data holds count vhal_canfd_area_value_t, areaId is unused
+    AREA_FLOAT = 7,
+};
+
+constexpr size_t kVhalCanFdHeaderSize = 12;
+constexpr size_t kVhalCanFdDataSize = CANFD_MAX_DLEN - kVhalCanFdHeaderSize;
+
+typedef struct __attribute__((packed, aligned(2))) vhal_canfd_msg_s {
+    int32_t     propId;
+    int32_t     areaId;
+    uint8_t     valueType;      // VhalCanValueType
+    uint8_t     count;          // number of elements in data
+    uint8_t     reserved[2];
+    uint8_t     data[kVhalCanFdDataSize];
+} vhal_canfd_msg_t;
+
+static_assert(sizeof(vhal_canfd_msg_t) == CANFD_MAX_DLEN, "vhal_canfd_msg_t must fill a CAN FD frame");
+
+/* CAN FD: the scalar values of several areas of one property, packed together. */
+typedef struct __attribute__((packed, aligned(2))) vhal_canfd_area_value_s {
+    int32_t     areaId;
+    union {
+        int32_t int32Value;
+        float   floatValue;
+    };
+} vhal_canfd_area_value_t;
+
+constexpr size_t kVhalCanFdMaxAreas = kVhalCanFdDataSize / sizeof(vhal_canfd_area_value_t);
+
+inline bool isCanFdAreaMessage(const vhal_canfd_msg_t& msg) {
+    return msg.valueType == static_cast<uint8_t>(VhalCanValueType::AREA_INT32)
+            || msg.valueType == static_cast<uint8_t>(VhalCanValueType::AREA_FLOAT);
+}
+
+/*
+ * Packs propValue into msg. Returns the number of bytes to send, already rounded up to
+ * a valid CAN FD data length, or 0 if the value does not fit into one frame.
+ */
+size_t encodeCanFdMessage(const VehiclePropValue& propValue, vhal_canfd_msg_t* msg);
+
+/*
+ * Replaces the value array of propValue that msg carries. The caller looks up propValue
+ * by msg->propId and msg->areaId. Returns false for malformed messages and for values
+ * whose type does not match the property's.
+ */
+bool decodeCanFdMessage(const vhal_canfd_msg_t& msg, size_t length, VehiclePropValue* propValue);
+
+/*
+ * Packs count (at most kVhalCanFdMaxAreas) area values of prop into msg. Returns the
+ * number of bytes to send, or 0 if they do not fit.
+ */
+size_t encodeCanFdAreas(int32_t prop, bool isFloat, const vhal_canfd_area_value_t* values,
+                        size_t count, vhal_canfd_msg_t* msg);
+
+/*
+ * Copies the area values of an area message into values (room for kVhalCanFdMaxAreas).
+ * Returns their number, 0 for malformed messages.
+ */
+size_t decodeCanFdAreas(const vhal_canfd_msg_t& msg, size_t length, vhal_canfd_area_value_t* values);
+
+/*
+ * Values that fit into neither frame format (int64 and byte arrays on classic CAN,
+ * strings, MIXED properties, anything longer than one CAN FD frame) travel as
+ * ISO 15765-2 messages with normal fixed addressing, 0x18DA<target><source>:
+ * the HAL is node 0xF1, the vehicle gateway node 0x10.
+ */
+constexpr canid_t kCanIsoTpTxId = CAN_EFF_FLAG | 0x18DA10F1;
+constexpr canid_t kCanIsoTpRxId = CAN_EFF_FLAG | 0x18DAF110;
+
+/* The header is followed by the arrays of the whole raw value, in this order. */
+typedef struct __attribute__((packed, aligned(2))) vhal_isotp_msg_hdr_s {
+    int32_t     propId;
+    int32_t     areaId;
+    uint16_t    int32Count;
+    uint16_t    floatCount;
+    uint16_t    int64Count;
+    uint16_t    bytesCount;
+    uint16_t    stringLength;
+} vhal_isotp_msg_hdr_t;
+
+/* Largest message, big enough for 4 KB of payload. */
+constexpr size_t kVhalIsoTpMaxMessageSize = 4096 + sizeof(vhal_isotp_msg_hdr_t) + 64;
+
+/*
+ * Packs the whole propValue into buffer. Returns the message length, or 0 if it
+ * does not fit into capacity bytes.
+ */
+size_t encodeIsoTpMessage(const VehiclePropValue& propValue, uint8_t* buffer, size_t capacity);
+
+/*
+ * Replaces the whole raw value of propValue with the one in buffer. The caller looks
+ * propValue up by the header. Returns false for malformed messages.
+ */
+bool decodeIsoTpMessage(const uint8_t* buffer, size_t length, VehiclePropValue* propValue);
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _CanProtocol_H_
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CanSignalCodec_H_
+#define _CanSignalCodec_H_
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <endian.h>
+#include <inttypes.h>
+
+#include <linux/can.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * DBC-style signal codec for classic (up to 8 bytes) CAN messages.
+ *
+ * Signals are declared with DBC conventions (start bit, length, byte order,
+ * factor, offset) and turned into shift/mask form at compile time, so
+ * decoding a message is one 64-bit load per byte order plus a shift, a mask
+ * and a multiply-add per signal.
+ */
+enum class CanByteOrder : uint8_t {
+    INTEL = 0,      // little endian, start bit is the LSB
+    MOTOROLA = 1,   // big endian, start bit is the MSB (DBC sawtooth numbering)
+};
+
+struct CanSignal {
+    canid_t         canId;
+    int32_t         prop;
+    int32_t         areaId;
+    CanByteOrder    order;
+    uint8_t         shift;      // LSB position within the 64-bit word of this byte order
+    uint8_t         length;
+    uint8_t         dlc;        // bytes the message needs to carry this signal
+    uint64_t        mask;
+    uint64_t        signBit;    // 0 for unsigned signals
+    float           scale;
+    float           offset;
+};
+
+struct CanMessage {
+    canid_t         canId;
+    uint8_t         dlc;
+    uint16_t        firstSignal;
+    uint16_t        signalCount;
+};
+
+constexpr size_t kCanMaxSignalsPerMessage = 64;
+
+constexpr CanSignal canSignal(canid_t canId, int32_t prop, int32_t areaId,
+                              uint8_t startBit, uint8_t length, CanByteOrder order,
+                              float scale, float offset, bool isSigned = false) {
+    // Position of the MSB counted from the first transmitted bit, big endian layout.
+    const int msbFromTop = (startBit / 8) * 8 + (7 - startBit % 8);
+    const int shift = (order == CanByteOrder::INTEL) ? startBit : 64 - msbFromTop - length;
+    const int lastBit = (order == CanByteOrder::INTEL) ? startBit + length - 1
+                                                       : msbFromTop + length - 1;
+
+    return CanSignal {
+        .canId = canId,
+        .prop = prop,
+        .areaId = areaId,
+        .order = order,
+        .shift = static_cast<uint8_t>(shift),
+        .length = length,
+        .dlc = static_cast<uint8_t>(lastBit / 8 + 1),
+        .mask = (length >= 64) ? ~0ULL : ((1ULL << length) - 1),
+        .signBit = isSigned ? (1ULL << (length - 1)) : 0,
+        .scale = scale,
+        .offset = offset,
+    };
+}
+
+/* Signals of one message must be declared next to each other, in ascending CAN ID order. */
+template <size_t N>
+constexpr bool isValidCanSignalTable(const CanSignal (&signals)[N]) {
+    size_t run = 0;
+    for (size_t i = 0; i < N; i++) {
+        const CanSignal& s = signals[i];
+        if (s.length == 0 || s.length > 32 || s.shift + s.length > 64 || s.dlc > CAN_MAX_DLEN) {
+            return false;
+        }
+        if (i > 0 && s.canId != signals[i - 1].canId) {
+            if (s.canId < signals[i - 1].canId) {
+                return false;
+            }
+            run = 0;
+        }
+        if (++run > kCanMaxSignalsPerMessage) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <size_t N>
+constexpr size_t countCanMessages(const CanSignal (&signals)[N]) {
+    size_t count = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (i == 0 || signals[i].canId != signals[i - 1].canId) {
+            count++;
+        }
+    }
+    return count;
+}
+
+template <size_t M, size_t N>
+constexpr std::array<CanMessage, M> makeCanMessages(const CanSignal (&signals)[N]) {
+    std::array<CanMessage, M> messages {};
+    size_t m = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (i > 0 && signals[i].canId == signals[i - 1].canId) {
+            CanMessage& message = messages[m - 1];
+            message.signalCount++;
+            if (signals[i].dlc > message.dlc) {
+                message.dlc = signals[i].dlc;
+            }
+            continue;
+        }
+        messages[m++] = CanMessage {
+            .canId = signals[i].canId,
+            .dlc = signals[i].dlc,
+            .firstSignal = static_cast<uint16_t>(i),
+            .signalCount = 1,
+        };
+    }
+    return messages;
+}
+
+template <size_t M>
+inline const CanMessage* findCanMessage(const std::array<CanMessage, M>& messages, canid_t canId) {
+    size_t lo = 0;
+    size_t hi = M;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (messages[mid].canId < canId) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < M && messages[lo].canId == canId) ? &messages[lo] : nullptr;
+}
+
+/* Loads the payload as one word per byte order; missing bytes read as zero. */
+inline void loadCanPayload(const uint8_t* data, size_t length, uint64_t words[2]) {
+    uint64_t raw = 0;
+    std::memcpy(&raw, data, (length < sizeof(raw)) ? length : sizeof(raw));
+    words[static_cast<size_t>(CanByteOrder::INTEL)] = le64toh(raw);
+    words[static_cast<size_t>(CanByteOrder::MOTOROLA)] = be64toh(raw);
+}
+
+inline void storeCanPayload(const uint64_t words[2], CanByteOrder order, uint8_t* data) {
+    uint64_t raw = (order == CanByteOrder::INTEL)
+            ? htole64(words[static_cast<size_t>(CanByteOrder::INTEL)])
+            : htobe64(words[static_cast<size_t>(CanByteOrder::MOTOROLA)]);
+    std::memcpy(data, &raw, sizeof(raw));
+}
+
+inline float decodeCanSignal(const CanSignal& signal, const uint64_t words[2]) {
+    uint64_t raw = (words[static_cast<size_t>(signal.order)] >> signal.shift) & signal.mask;
+    int64_t value = static_cast<int64_t>(raw ^ signal.signBit) - static_cast<int64_t>(signal.signBit);
+    return value * signal.scale + signal.offset;
+}
+
+/* Decodes all signals of message in one pass. out must hold message.signalCount values. */
+inline void decodeCanMessage(const CanMessage& message, const CanSignal* signals,
+                             const uint8_t* data, size_t length, float* out) {
+    uint64_t words[2];
+    loadCanPayload(data, length, words);
+
+    const CanSignal* signal = signals + message.firstSignal;
+    for (size_t i = 0; i < message.signalCount; i++) {
+        out[i] = decodeCanSignal(signal[i], words);
+    }
+}
+
+/* Writes the physical value of signal into an 8-byte payload, clamped to the signal range. */
+inline void encodeCanSignal(const CanSignal& signal, float value, uint8_t* data) {
+    const int64_t minRaw = -static_cast<int64_t>(signal.signBit);
+    const int64_t maxRaw = static_cast<int64_t>(signal.signBit ? signal.signBit - 1 : signal.mask);
+
+    int64_t raw = std::llround((value - signal.offset) / signal.scale);
+    raw = (raw < minRaw) ? minRaw : (raw > maxRaw) ? maxRaw : raw;
+
+    uint64_t words[2];
+    loadCanPayload(data, CAN_MAX_DLEN, words);
+
+    uint64_t& word = words[static_cast<size_t>(signal.order)];
+    word &= ~(signal.mask << signal.shift);
+    word |= (static_cast<uint64_t>(raw) & signal.mask) << signal.shift;
+
+    storeCanPayload(words, signal.order, data);
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _CanSignalCodec_H_
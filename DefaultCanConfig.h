@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _DefaultCanConfig_H_
+#define _DefaultCanConfig_H_
+
+#include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "CanSignalCodec.h"
+#include "DefaultConfig.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * Vehicle bus signals mapped onto properties, in DBC terms:
+ *
+ *   canSignal(CAN ID, property, area, start bit, length, byte order, factor, offset[, signed])
+ *
+ * Signals of one message are declared together and messages are sorted by CAN ID.
+ * Properties not listed here are exchanged as VHAL messages, see CanProtocol.h.
+ */
+constexpr CanSignal kCanSignals[] = {
+    // 0x0C0 PT_ENGINE, 10 ms
+    canSignal(0x0C0, toInt(VehicleProperty::ENGINE_RPM), 0, 0, 16, CanByteOrder::INTEL, 0.25f, 0.0f),
+    canSignal(0x0C0, toInt(VehicleProperty::ENGINE_OIL_TEMP), 0, 16, 8, CanByteOrder::INTEL, 1.0f, -40.0f),
+
+    // 0x0C4 PT_VEHICLE, 10 ms
+    canSignal(0x0C4, toInt(VehicleProperty::PERF_VEHICLE_SPEED), 0, 0, 16, CanByteOrder::INTEL, 0.01f, 0.0f),
+    canSignal(0x0C4, toInt(VehicleProperty::CURRENT_GEAR), 0, 16, 16, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x0C4, toInt(VehicleProperty::PARKING_BRAKE_ON), 0, 32, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x100 PT_POWER, 100 ms
+    canSignal(0x100, toInt(VehicleProperty::IGNITION_STATE), 0, 0, 4, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x1F0 CH_STATUS, 20 ms
+    canSignal(0x1F0, toInt(VehicleProperty::ABS_ACTIVE), 0, 0, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x1F0, toInt(VehicleProperty::TRACTION_CONTROL_ACTIVE), 0, 1, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x2A0 BODY_DOORS, 100 ms
+    canSignal(0x2A0, toInt(VehicleProperty::DOOR_LOCK), DOOR_1_LEFT, 0, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x2A0, toInt(VehicleProperty::DOOR_LOCK), DOOR_1_RIGHT, 1, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x2A0, toInt(VehicleProperty::DOOR_LOCK), DOOR_2_LEFT, 2, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x2A0, toInt(VehicleProperty::DOOR_LOCK), DOOR_2_RIGHT, 3, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x2B0 HVAC_SETPOINTS, 200 ms
+    canSignal(0x2B0, toInt(VehicleProperty::HVAC_TEMPERATURE_SET), HVAC_LEFT, 0, 8, CanByteOrder::INTEL,
+              0.5f, 0.0f),
+    canSignal(0x2B0, toInt(VehicleProperty::HVAC_TEMPERATURE_SET), HVAC_RIGHT, 8, 8, CanByteOrder::INTEL,
+              0.5f, 0.0f),
+    canSignal(0x2B0, toInt(VehicleProperty::HVAC_SEAT_TEMPERATURE), SEAT_1_LEFT, 16, 4, CanByteOrder::INTEL,
+              1.0f, 0.0f, true),
+    canSignal(0x2B0, toInt(VehicleProperty::HVAC_SEAT_TEMPERATURE), SEAT_1_RIGHT, 20, 4, CanByteOrder::INTEL,
+              1.0f, 0.0f, true),
+
+    // 0x3A0 BODY_FUEL, 500 ms
+    canSignal(0x3A0, toInt(VehicleProperty::FUEL_LEVEL), 0, 0, 16, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3A0, toInt(VehicleProperty::FUEL_DOOR_OPEN), 0, 16, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3A0, toInt(VehicleProperty::FUEL_LEVEL_LOW), 0, 17, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3A0, toInt(VehicleProperty::RANGE_REMAINING), 0, 24, 24, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x3B0 BODY_ENV, 1000 ms
+    canSignal(0x3B0, toInt(VehicleProperty::PERF_ODOMETER), 0, 7, 24, CanByteOrder::MOTOROLA, 0.1f, 0.0f),
+    canSignal(0x3B0, toInt(VehicleProperty::ENV_OUTSIDE_TEMPERATURE), 0, 31, 8, CanByteOrder::MOTOROLA, 0.5f, -40.0f),
+    canSignal(0x3B0, toInt(VehicleProperty::NIGHT_MODE), 0, 39, 1, CanByteOrder::MOTOROLA, 1.0f, 0.0f),
+
+    // 0x3C0 BODY_LIGHTS, 100 ms
+    canSignal(0x3C0, toInt(VehicleProperty::HEADLIGHTS_STATE), 0, 0, 2, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3C0, toInt(VehicleProperty::HIGH_BEAM_LIGHTS_STATE), 0, 2, 2, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3C0, toInt(VehicleProperty::FOG_LIGHTS_STATE), 0, 4, 2, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3C0, toInt(VehicleProperty::HAZARD_LIGHTS_STATE), 0, 6, 2, CanByteOrder::INTEL, 1.0f, 0.0f),
+
+    // 0x3D0 EV_STATUS, 500 ms
+    canSignal(0x3D0, toInt(VehicleProperty::EV_BATTERY_LEVEL), 0, 0, 16, CanByteOrder::INTEL, 10.0f, 0.0f),
+    canSignal(0x3D0, toInt(VehicleProperty::EV_CHARGE_PORT_OPEN), 0, 16, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3D0, toInt(VehicleProperty::EV_CHARGE_PORT_CONNECTED), 0, 17, 1, CanByteOrder::INTEL, 1.0f, 0.0f),
+    canSignal(0x3D0, toInt(VehicleProperty::EV_BATTERY_INSTANTANEOUS_CHARGE_RATE), 0, 24, 16,
+              CanByteOrder::INTEL, 10000.0f, 0.0f, true),
+
+    // 0x3E0 CH_TIRES, 1000 ms
+    canSignal(0x3E0, toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_FRONT_LEFT, 0, 16, CanByteOrder::INTEL,
+              0.1f, 0.0f),
+    canSignal(0x3E0, toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_FRONT_RIGHT, 16, 16, CanByteOrder::INTEL,
+              0.1f, 0.0f),
+    canSignal(0x3E0, toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_REAR_LEFT, 32, 16, CanByteOrder::INTEL,
+              0.1f, 0.0f),
+    canSignal(0x3E0, toInt(VehicleProperty::TIRE_PRESSURE), WHEEL_REAR_RIGHT, 48, 16, CanByteOrder::INTEL,
+              0.1f, 0.0f),
+};
+
+static_assert(isValidCanSignalTable(kCanSignals),
+              "kCanSignals: signal out of range or messages not grouped by ascending CAN ID");
+
+constexpr auto kCanMessages = makeCanMessages<countCanMessages(kCanSignals)>(kCanSignals);
+
+/*
+ * Float properties received from the vehicle are reported only once they
+ * move by more than the deadband (in property units) from the last
+ * reported value. Applies to ON_CHANGE properties; others use 0.
+ */
+struct CanDeadband {
+    int32_t     prop;
+    float       deadband;
+};
+
+constexpr CanDeadband kCanDeadbands[] = {
+    {toInt(VehicleProperty::PERF_ODOMETER), 0.1f},                          // km
+    {toInt(VehicleProperty::FUEL_LEVEL), 100.0f},                           // ml
+    {toInt(VehicleProperty::EV_BATTERY_LEVEL), 50.0f},                      // Wh
+    {toInt(VehicleProperty::EV_BATTERY_INSTANTANEOUS_CHARGE_RATE), 50000.0f}, // mW
+};
+
+/*
+ * Buses are indices into ro.vendor.vehicle.can.interfaces. Routes to a bus
+ * that is not configured fall back to the first one, so a single interface
+ * still carries everything.
+ */
+constexpr uint8_t kCanBusPowertrain = 0;
+constexpr uint8_t kCanBusBody = 1;
+constexpr uint8_t kCanBusInfotainment = 2;
+
+struct CanMessageRoute {
+    canid_t     canId;
+    uint8_t     bus;
+};
+
+struct CanPropertyRoute {
+    int32_t     prop;
+    uint8_t     bus;
+};
+
+constexpr CanMessageRoute kCanMessageRoutes[] = {
+    {0x0C0, kCanBusPowertrain},
+    {0x0C4, kCanBusPowertrain},
+    {0x100, kCanBusPowertrain},
+    {0x1F0, kCanBusPowertrain},
+    {0x2A0, kCanBusBody},
+    {0x2B0, kCanBusBody},
+    {0x3A0, kCanBusBody},
+    {0x3B0, kCanBusBody},
+    {0x3C0, kCanBusBody},
+    {0x3D0, kCanBusPowertrain},
+    {0x3E0, kCanBusPowertrain},
+};
+
+/* ISO-TP messages (CanProtocol.h) of all properties. */
+constexpr uint8_t kCanIsoTpBus = kCanBusInfotainment;
+
+/* VHAL messages (CanProtocol.h) of properties not listed go to kCanBusInfotainment. */
+constexpr uint8_t kCanDefaultPropertyBus = kCanBusInfotainment;
+
+constexpr CanPropertyRoute kCanPropertyRoutes[] = {
+    {toInt(VehicleProperty::HVAC_POWER_ON), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_FAN_SPEED), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_FAN_DIRECTION), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_TEMPERATURE_SET), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_AC_ON), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_AUTO_ON), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_RECIRC_ON), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_DEFROSTER), kCanBusBody},
+    {toInt(VehicleProperty::HVAC_SEAT_TEMPERATURE), kCanBusBody},
+    {toInt(VehicleProperty::DOOR_LOCK), kCanBusBody},
+    {toInt(VehicleProperty::GEAR_SELECTION), kCanBusPowertrain},
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _DefaultCanConfig_H_
@@ -20,6 +20,9 @@
 #include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
 #include <vhal_v2_0/VehicleUtils.h>
 
+#include "PropertyGating.h"
+#include "VehicleHalConfig.h"
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -89,9 +92,40 @@ constexpr int WHEEL_REAR_RIGHT = (int)VehicleAreaWheel::RIGHT_REAR;
  * int32Values[1] - VehicleProperty to which command applies
   */
 
-const int32_t kHvacPowerProperties[] = {
-    toInt(VehicleProperty::HVAC_FAN_SPEED),
-    toInt(VehicleProperty::HVAC_FAN_DIRECTION),
+/* Properties set() refuses with NOT_AVAILABLE while another one is in a given state. */
+const PropertyGateDeclaration kPropertyGates[] = {
+    {
+        .controlProp = toInt(VehicleProperty::HVAC_POWER_ON),
+        .controlArea = HVAC_ALL,
+        .minValue = 1,
+        .maxValue = INT32_MAX,
+        .gatedProps = {
+            toInt(VehicleProperty::HVAC_FAN_SPEED),
+            toInt(VehicleProperty::HVAC_FAN_DIRECTION),
+        }
+    },
+    {
+        // Hazard, cabin and reading lights keep working with the ignition off.
+        .controlProp = toInt(VehicleProperty::IGNITION_STATE),
+        .controlArea = 0,
+        .minValue = toInt(VehicleIgnitionState::ACC),
+        .maxValue = toInt(VehicleIgnitionState::START),
+        .gatedProps = {
+            toInt(VehicleProperty::HEADLIGHTS_SWITCH),
+            toInt(VehicleProperty::HIGH_BEAM_LIGHTS_SWITCH),
+            toInt(VehicleProperty::FOG_LIGHTS_SWITCH),
+        }
+    },
+    {
+        // The port stays as it is while a charging cable is plugged in.
+        .controlProp = toInt(VehicleProperty::EV_CHARGE_PORT_CONNECTED),
+        .controlArea = 0,
+        .minValue = 0,
+        .maxValue = 0,
+        .gatedProps = {
+            toInt(VehicleProperty::EV_CHARGE_PORT_OPEN),
+        }
+    },
 };
 
 struct ConfigDeclaration {
@@ -103,6 +137,8 @@ struct ConfigDeclaration {
     VehiclePropValue::RawValue initialValue;
     /* Use initialAreaValues if it is necessary to specify different values per each area. */
     std::map<int32_t, VehiclePropValue::RawValue> initialAreaValues;
+    /* Priority and rate limit of the CAN frames carrying values set by Android. */
+    CanTxPolicy txPolicy;
 };
 
 const ConfigDeclaration kVehicleProperties[]{
@@ -368,7 +404,7 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = HVAC_ALL}
         },
         // TODO(bryaneyler): Ideally, this is generated dynamically from
-        // kHvacPowerProperties.
+        // kPropertyGates.
         .configArray =
         {
             toInt(VehicleProperty::HVAC_FAN_SPEED),
@@ -475,7 +511,8 @@ const ConfigDeclaration kVehicleProperties[]{
                 }
             }
         },
-        .initialValue = {.int32Values = {3}}
+        .initialValue = {.int32Values = {3}},
+        .txPolicy = {CanTxPriority::NORMAL, std::chrono::milliseconds(100)}
     },
     {
         .config =
@@ -561,7 +598,8 @@ const ConfigDeclaration kVehicleProperties[]{
                 }
             }
         },
-        .initialValue = {.int32Values = {0}}  // +ve values for heating and -ve for cooling
+        .initialValue = {.int32Values = {0}},  // +ve values for heating and -ve for cooling
+        .txPolicy = {CanTxPriority::LOW, std::chrono::milliseconds(100)}
     },
     {
         .config =
@@ -596,7 +634,8 @@ const ConfigDeclaration kVehicleProperties[]{
                         .floatValues = {20}
                     }
             }
-        }
+        },
+        .txPolicy = {CanTxPriority::NORMAL, std::chrono::milliseconds(100)}
     },
     {
         .config =
@@ -618,7 +657,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}}
         },
-        .initialValue = {.int32Values = {(int)VehicleUnit::CELSIUS}}
+        .initialValue = {.int32Values = {(int)VehicleUnit::CELSIUS}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -714,7 +754,8 @@ const ConfigDeclaration kVehicleProperties[]{
                     .int32Values = {1}
                 }
             }
-        }
+        },
+        .txPolicy = {CanTxPriority::HIGH}
     },
     {
         .config =
@@ -776,7 +817,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .access = VehiclePropertyAccess::WRITE,
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE
         },
-        .initialValue = {.int32Values = {toInt(VehicleApPowerStateReport::WAIT_FOR_VHAL), 0}}
+        .initialValue = {.int32Values = {toInt(VehicleApPowerStateReport::WAIT_FOR_VHAL), 0}},
+        .txPolicy = {CanTxPriority::HIGH}
     },
     {
         .config =
@@ -791,7 +833,8 @@ const ConfigDeclaration kVehicleProperties[]{
                 }
             }
         },
-        .initialValue = {.int32Values = {100}}
+        .initialValue = {.int32Values = {100}},
+        .txPolicy = {CanTxPriority::LOW, std::chrono::milliseconds(100)}
     },
     {
         .config =
@@ -876,7 +919,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
         },
-        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}}
+        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}},
+        .txPolicy = {CanTxPriority::HIGH}
     },
     {
         .config =
@@ -886,7 +930,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
         },
-        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}}
+        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}},
+        .txPolicy = {CanTxPriority::HIGH}
     },
     {
         .config =
@@ -896,7 +941,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
         },
-        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}}
+        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}},
+        .txPolicy = {CanTxPriority::HIGH}
     },
     {
         .config =
@@ -906,7 +952,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
         },
-        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}}
+        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}},
+        .txPolicy = {CanTxPriority::HIGH}
     },
     //since Android Q
     {
@@ -927,7 +974,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .changeMode = VehiclePropertyChangeMode::ON_CHANGE,
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
         },
-        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}}
+        .initialValue = {.int32Values = {LIGHT_SWITCH_AUTO}},
+        .txPolicy = {CanTxPriority::LOW, std::chrono::milliseconds(50)}
     },
     {
         .config =
@@ -1045,7 +1093,8 @@ const ConfigDeclaration kVehicleProperties[]{
                     .int32Values = {LIGHT_SWITCH_AUTO}
                 }
             }
-        }
+        },
+        .txPolicy = {CanTxPriority::LOW, std::chrono::milliseconds(50)}
     },
     {
         .config =
@@ -1056,7 +1105,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
             .configArray = {0, 0, 0}
         },
-        .initialValue = {.int32Values = {0}}
+        .initialValue = {.int32Values = {0}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -1067,7 +1117,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
             .configArray = {0, 0, 0}
         },
-        .initialValue = {.int32Values = {0}}
+        .initialValue = {.int32Values = {0}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -1078,7 +1129,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
             .configArray = {0, 0, 0}
         },
-        .initialValue = {.int32Values = {0}}
+        .initialValue = {.int32Values = {0}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -1089,7 +1141,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
             .configArray = {0, 0, 0}
         },
-        .initialValue = {.int32Values = {0}}
+        .initialValue = {.int32Values = {0}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -1110,7 +1163,8 @@ const ConfigDeclaration kVehicleProperties[]{
             .areaConfigs = {VehicleAreaConfig{.areaId = (0)}},
             .configArray = {0, 0, 0}
         },
-        .initialValue = {.int32Values = {0}}
+        .initialValue = {.int32Values = {0}},
+        .txPolicy = {CanTxPriority::LOW}
     },
     {
         .config =
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include <log/log.h>
+
+#include "EventLoop.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+EventLoop::EventLoop(void) :
+    mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+    mWakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    mExit(false)
+{
+    if (mEpollFd < 0 || mWakeFd < 0) {
+        ALOGE("Event loop is NOT created (error %d)", errno);
+        return;
+    }
+
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data = { .fd = mWakeFd }
+    };
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event) < 0) {
+        ALOGE("epoll_ctl wake fd failed (error %d)", errno);
+    }
+}
+
+EventLoop::~EventLoop(void)
+{
+    stop();
+
+    if (mWakeFd != -1) {
+        close(mWakeFd);
+    }
+    if (mEpollFd != -1) {
+        close(mEpollFd);
+    }
+}
+
+bool EventLoop::addFd(int fd, uint32_t events, Callback callback)
+{
+    struct epoll_event event = {
+        .events = events,
+        .data = { .fd = fd }
+    };
+
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        ALOGE("epoll_ctl add fd %d failed (error %d)", fd, errno);
+        return false;
+    }
+
+    mSources[fd] = Source { std::move(callback), false };
+    mRemovedFds.erase(std::remove(mRemovedFds.begin(), mRemovedFds.end(), fd), mRemovedFds.end());
+    return true;
+}
+
+void EventLoop::removeFd(int fd)
+{
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+
+    auto it = mSources.find(fd);
+    if (it == mSources.end()) {
+        return;
+    }
+
+    // The callback may be the one running right now, keep it alive until the batch is done.
+    if (isLoopThread()) {
+        it->second.removed = true;
+        mRemovedFds.push_back(fd);
+    } else {
+        mSources.erase(it);
+    }
+}
+
+int EventLoop::addTimer(std::function<void(void)> callback)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0) {
+        ALOGE("timerfd_create failed (error %d)", errno);
+        return -1;
+    }
+
+    bool added = addFd(fd, EPOLLIN, [fd, callback](uint32_t) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+            callback();
+        }
+    });
+    if (!added) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void EventLoop::armTimer(int fd, std::chrono::nanoseconds first, std::chrono::nanoseconds interval)
+{
+    // A zero "first" disarms the timer.
+    struct itimerspec spec = {
+        .it_interval = {
+            .tv_sec = static_cast<time_t>(interval.count() / 1000000000),
+            .tv_nsec = static_cast<long>(interval.count() % 1000000000)
+        },
+        .it_value = {
+            .tv_sec = static_cast<time_t>(first.count() / 1000000000),
+            .tv_nsec = static_cast<long>(first.count() % 1000000000)
+        }
+    };
+
+    if (timerfd_settime(fd, 0, &spec, NULL) < 0) {
+        ALOGE("timerfd_settime failed (error %d)", errno);
+    }
+}
+
+int EventLoop::addEvent(std::function<void(void)> callback)
+{
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0) {
+        ALOGE("eventfd failed (error %d)", errno);
+        return -1;
+    }
+
+    bool added = addFd(fd, EPOLLIN, [fd, callback](uint32_t) {
+        uint64_t notifications;
+        if (read(fd, &notifications, sizeof(notifications)) == sizeof(notifications)) {
+            callback();
+        }
+    });
+    if (!added) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void EventLoop::notify(int fd)
+{
+    const uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0) {
+        ALOGW("eventfd write failed (error %d)", errno);
+    }
+}
+
+void EventLoop::start(void)
+{
+    if (mEpollFd < 0 || mThread.joinable()) {
+        return;
+    }
+    mThread = std::thread(&EventLoop::run, this);
+}
+
+void EventLoop::stop(void)
+{
+    mExit = true;
+
+    if (mWakeFd != -1) {
+        uint64_t one = 1;
+        if (write(mWakeFd, &one, sizeof(one)) < 0) {
+            ALOGW("Event loop wake up failed (error %d)", errno);
+        }
+    }
+
+    if (mThread.joinable() && !isLoopThread()) {
+        mThread.join();
+    }
+}
+
+void EventLoop::run(void)
+{
+    struct epoll_event events[kMaxEvents];
+
+    ALOGD("EventLoop() ->");
+
+    while (!mExit) {
+        int count = epoll_wait(mEpollFd, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("epoll_wait failed (error %d)", errno);
+            break;
+        }
+
+        for (int i = 0; i < count && !mExit; i++) {
+            // Look the source up per event: an earlier callback may have removed it.
+            auto it = mSources.find(events[i].data.fd);
+            if (it != mSources.end() && !it->second.removed) {
+                it->second.callback(events[i].events);
+            }
+        }
+
+        for (int fd : mRemovedFds) {
+            mSources.erase(fd);
+        }
+        mRemovedFds.clear();
+    }
+
+    ALOGD("EventLoop() <-");
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EventLoop_H_
+#define _EventLoop_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <inttypes.h>
+#include <sys/epoll.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * Single-threaded epoll reactor. Sources are added before start() or from
+ * callbacks running on the loop thread; stop() may be called from any thread
+ * and returns once the loop thread has finished.
+ */
+class EventLoop {
+public:
+    using Callback = std::function<void(uint32_t events)>;
+
+    EventLoop(void);
+    ~EventLoop(void);
+
+    bool addFd(int fd, uint32_t events, Callback callback);
+    void removeFd(int fd);
+
+    /* Creates a timerfd source; callback runs on every expiration. Returns the fd or -1. */
+    int addTimer(std::function<void(void)> callback);
+    static void armTimer(int fd, std::chrono::nanoseconds first,
+                         std::chrono::nanoseconds interval = std::chrono::nanoseconds(0));
+
+    /* Creates an eventfd source; callback runs on the loop thread after notify() from any thread. */
+    int addEvent(std::function<void(void)> callback);
+    static void notify(int fd);
+
+    void start(void);
+    void stop(void);
+    bool isLoopThread(void) const { return std::this_thread::get_id() == mThread.get_id(); }
+
+private:
+    static constexpr int kMaxEvents = 16;
+
+    struct Source {
+        Callback    callback;
+        bool        removed;
+    };
+
+    void run(void);
+
+    int                                 mEpollFd;
+    int                                 mWakeFd;
+    std::atomic<bool>                   mExit;
+    std::thread                         mThread;
+    std::unordered_map<int, Source>     mSources;
+    std::vector<int>                    mRemovedFds;    // erased once the current batch is dispatched
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _EventLoop_H_
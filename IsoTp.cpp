@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <log/log.h>
+
+#include "IsoTp.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static constexpr size_t kIsoTpMaxFirstFrameLength = 0xfff;
+
+static size_t isoTpPaddedLength(size_t length, size_t frameSize)
+{
+    static constexpr size_t kValidLengths[] = {8, 12, 16, 20, 24, 32, 48, 64};
+
+    // Classic CAN frames are always padded to 8 bytes.
+    if (frameSize <= CAN_MAX_DLEN) {
+        return CAN_MAX_DLEN;
+    }
+    for (size_t valid : kValidLengths) {
+        if (length <= valid) {
+            return valid;
+        }
+    }
+    return CANFD_MAX_DLEN;
+}
+
+static std::chrono::nanoseconds isoTpStMin(uint8_t stMin)
+{
+    if (stMin <= 0x7f) {
+        return std::chrono::milliseconds(stMin);
+    }
+    if (stMin >= 0xf1 && stMin <= 0xf9) {
+        return std::chrono::microseconds((stMin - 0xf0) * 100);
+    }
+    return std::chrono::milliseconds(0x7f);     // Reserved values mean the longest gap
+}
+
+IsoTpReceiver::IsoTpReceiver(size_t maxMessageSize, uint8_t blockSize, uint8_t stMin,
+                             SendFrame sendFrame) :
+    mBuffer(maxMessageSize),
+    mBlockSize(blockSize),
+    mStMin(stMin),
+    mSendFrame(std::move(sendFrame)),
+    mExpected(0),
+    mReceived(0),
+    mFrameSize(0),
+    mSequence(0),
+    mBlockLeft(0),
+    mInProgress(false),
+    mLastFrame(0)
+{
+}
+
+IsoTpReceiver::Result IsoTpReceiver::onFrame(const uint8_t* data, size_t length, int64_t timestamp)
+{
+    if (length == 0) {
+        return Result::ERROR;
+    }
+
+    switch (isoTpPci(data)) {
+        case IsoTpPci::SINGLE:
+            return onSingleFrame(data, length);
+        case IsoTpPci::FIRST:
+            return onFirstFrame(data, length, timestamp);
+        case IsoTpPci::CONSECUTIVE:
+            return onConsecutiveFrame(data, length, timestamp);
+        default:
+            return Result::ERROR;   // Flow control belongs to the sending side
+    }
+}
+
+IsoTpReceiver::Result IsoTpReceiver::onSingleFrame(const uint8_t* data, size_t length)
+{
+    size_t dataLength = data[0] & 0x0f;
+    size_t offset = 1;
+
+    if (dataLength == 0 && length > CAN_MAX_DLEN) {
+        dataLength = data[1];   // CAN FD escape
+        offset = 2;
+    }
+    if (dataLength == 0 || offset + dataLength > length || dataLength > mBuffer.size()) {
+        return Result::ERROR;
+    }
+
+    // A single frame terminates a reception in progress.
+    if (mInProgress) {
+        mInProgress = false;
+        mStats.aborted++;
+    }
+
+    std::memcpy(mBuffer.data(), data + offset, dataLength);
+    mExpected = dataLength;
+    mStats.completed++;
+    return Result::COMPLETE;
+}
+
+IsoTpReceiver::Result IsoTpReceiver::onFirstFrame(const uint8_t* data, size_t length,
+                                                  int64_t timestamp)
+{
+    if (length < CAN_MAX_DLEN) {
+        return Result::ERROR;   // First frames always use the whole frame
+    }
+
+    // A first frame restarts a reception in progress.
+    if (mInProgress) {
+        mInProgress = false;
+        mStats.aborted++;
+    }
+
+    size_t dataLength = ((data[0] & 0x0f) << 8) | data[1];
+    size_t offset = 2;
+
+    if (dataLength == 0) {
+        // Messages longer than 4095 bytes carry a 32-bit length.
+        dataLength = (size_t(data[2]) << 24) | (size_t(data[3]) << 16) |
+                     (size_t(data[4]) << 8) | data[5];
+        offset = 6;
+    }
+    if (dataLength > mBuffer.size()) {
+        ALOGW("ISO-TP message of %zu bytes exceeds %zu byte buffer", dataLength, mBuffer.size());
+        sendFlowControl(2);
+        mStats.aborted++;
+        return Result::ERROR;
+    }
+
+    const size_t chunk = std::min(length - offset, dataLength);
+    std::memcpy(mBuffer.data(), data + offset, chunk);
+    mExpected = dataLength;
+    mReceived = chunk;
+    mFrameSize = length;
+    mSequence = 1;
+    mBlockLeft = mBlockSize;
+    mInProgress = true;
+    mLastFrame = timestamp;
+
+    sendFlowControl(0);
+    return Result::IN_PROGRESS;
+}
+
+IsoTpReceiver::Result IsoTpReceiver::onConsecutiveFrame(const uint8_t* data, size_t length,
+                                                        int64_t timestamp)
+{
+    if (!mInProgress) {
+        return Result::ERROR;
+    }
+    if (timestamp - mLastFrame > std::chrono::nanoseconds(kIsoTpTimeout).count()) {
+        ALOGW("ISO-TP consecutive frame timeout");
+        return abort();
+    }
+    if ((data[0] & 0x0f) != mSequence) {
+        ALOGW("ISO-TP sequence error: %d, expected %d", data[0] & 0x0f, mSequence);
+        return abort();
+    }
+
+    const size_t chunk = std::min(length - 1, mExpected - mReceived);
+    if (chunk < mExpected - mReceived && length != mFrameSize) {
+        return abort();         // Only the last frame may be short
+    }
+
+    std::memcpy(mBuffer.data() + mReceived, data + 1, chunk);
+    mReceived += chunk;
+    mSequence = (mSequence + 1) & 0x0f;
+    mLastFrame = timestamp;
+
+    if (mReceived == mExpected) {
+        mInProgress = false;
+        mStats.completed++;
+        return Result::COMPLETE;
+    }
+
+    if (mBlockSize != 0 && --mBlockLeft == 0) {
+        mBlockLeft = mBlockSize;
+        sendFlowControl(0);
+    }
+    return Result::IN_PROGRESS;
+}
+
+void IsoTpReceiver::sendFlowControl(uint8_t status)
+{
+    uint8_t frame[CAN_MAX_DLEN];
+    std::memset(frame, kIsoTpPadding, sizeof(frame));
+    frame[0] = (static_cast<uint8_t>(IsoTpPci::FLOW_CONTROL) << 4) | status;
+    frame[1] = mBlockSize;
+    frame[2] = mStMin;
+
+    if (!mSendFrame(frame, sizeof(frame))) {
+        ALOGW("ISO-TP flow control was not sent");
+    }
+}
+
+IsoTpReceiver::Result IsoTpReceiver::abort(void)
+{
+    mInProgress = false;
+    mStats.aborted++;
+    return Result::ERROR;
+}
+
+IsoTpSender::IsoTpSender(size_t maxMessageSize, SendFrame sendFrame) :
+    mBuffer(maxMessageSize),
+    mSendFrame(std::move(sendFrame)),
+    mState(State::IDLE),
+    mLength(0),
+    mSent(0),
+    mFrameSize(CAN_MAX_DLEN),
+    mSequence(0),
+    mBlockSize(0),
+    mBlockLeft(0),
+    mStMin(0),
+    mBackoff(kIsoTpMinBackoff)
+{
+}
+
+bool IsoTpSender::start(const uint8_t* message, size_t length, size_t frameSize)
+{
+    if (mState != State::IDLE || length == 0 || length > mBuffer.size()) {
+        return false;
+    }
+
+    uint8_t frame[CANFD_MAX_DLEN];
+    std::memset(frame, kIsoTpPadding, sizeof(frame));
+    mFrameSize = (frameSize > CAN_MAX_DLEN) ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+
+    // Single frame: the PCI byte holds the length, CAN FD escapes longer ones.
+    if (length <= CAN_MAX_DLEN - 1 || length <= mFrameSize - 2) {
+        size_t offset = 1;
+        if (length <= CAN_MAX_DLEN - 1) {
+            frame[0] = static_cast<uint8_t>(length);
+        } else {
+            frame[0] = 0;
+            frame[1] = static_cast<uint8_t>(length);
+            offset = 2;
+        }
+        std::memcpy(frame + offset, message, length);
+
+        if (!mSendFrame(frame, isoTpPaddedLength(offset + length, mFrameSize))) {
+            countStartFailure();
+            return false;
+        }
+        mStats.completed++;
+        return true;
+    }
+
+    size_t offset = 2;
+    frame[0] = static_cast<uint8_t>(IsoTpPci::FIRST) << 4;
+    if (length <= kIsoTpMaxFirstFrameLength) {
+        frame[0] |= static_cast<uint8_t>(length >> 8);
+        frame[1] = static_cast<uint8_t>(length);
+    } else {
+        frame[1] = 0;
+        frame[2] = static_cast<uint8_t>(length >> 24);
+        frame[3] = static_cast<uint8_t>(length >> 16);
+        frame[4] = static_cast<uint8_t>(length >> 8);
+        frame[5] = static_cast<uint8_t>(length);
+        offset = 6;
+    }
+
+    std::memcpy(mBuffer.data(), message, length);
+    mLength = length;
+    mSent = mFrameSize - offset;
+    std::memcpy(frame + offset, mBuffer.data(), mSent);
+
+    if (!mSendFrame(frame, mFrameSize)) {
+        countStartFailure();
+        return false;
+    }
+
+    mSequence = 1;
+    mState = State::WAIT_FLOW_CONTROL;
+    mDeadline = std::chrono::steady_clock::now() + kIsoTpTimeout;
+    return true;
+}
+
+void IsoTpSender::onFlowControl(const uint8_t* data, size_t length)
+{
+    if (mState != State::WAIT_FLOW_CONTROL || length < 3) {
+        return;
+    }
+
+    switch (data[0] & 0x0f) {
+        case 0:     // Continue to send
+            mBlockSize = data[1];
+            mBlockLeft = mBlockSize;
+            mStMin = isoTpStMin(data[2]);
+            mBackoff = kIsoTpMinBackoff;
+            mState = State::SENDING;
+            mDeadline = std::chrono::steady_clock::now();
+            break;
+        case 1:     // Wait
+            mDeadline = std::chrono::steady_clock::now() + kIsoTpTimeout;
+            break;
+        default:    // Overflow or invalid
+            ALOGW("ISO-TP transfer of %zu bytes refused (flow status %d)", mLength, data[0] & 0x0f);
+            abort();
+            break;
+    }
+}
+
+std::chrono::nanoseconds IsoTpSender::poll(void)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    if (mState == State::WAIT_FLOW_CONTROL && now >= mDeadline) {
+        ALOGW("ISO-TP flow control timeout");
+        abort();
+    }
+
+    while (mState == State::SENDING && now >= mDeadline) {
+        if (!sendConsecutiveFrame()) {
+            if (errno != ENOBUFS && errno != EAGAIN) {
+                abort();
+                break;
+            }
+            // The frame was not sent, so it is retried with the same sequence number.
+            if (mBackoff == kIsoTpMinBackoff) {
+                mStallDeadline = now + kIsoTpTimeout;
+            } else if (now >= mStallDeadline) {
+                ALOGW("ISO-TP transmit queue full for %lld ms",
+                      static_cast<long long>(kIsoTpTimeout.count()));
+                abort();
+                break;
+            }
+            mStats.backoffs++;
+            mDeadline = now + mBackoff;
+            mBackoff = std::min(mBackoff * 2, std::chrono::nanoseconds(kIsoTpMaxBackoff));
+            break;
+        }
+        mBackoff = kIsoTpMinBackoff;
+
+        if (mSent == mLength) {
+            mState = State::IDLE;
+            mStats.completed++;
+        } else if (mBlockSize != 0 && --mBlockLeft == 0) {
+            mState = State::WAIT_FLOW_CONTROL;
+            mDeadline = now + kIsoTpTimeout;
+        } else if (mStMin.count() != 0) {
+            mDeadline = now + mStMin;
+        }
+    }
+
+    if (mState == State::IDLE) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(mDeadline - now);
+}
+
+bool IsoTpSender::sendConsecutiveFrame(void)
+{
+    uint8_t frame[CANFD_MAX_DLEN];
+    std::memset(frame, kIsoTpPadding, sizeof(frame));
+
+    const size_t chunk = std::min(mFrameSize - 1, mLength - mSent);
+    frame[0] = (static_cast<uint8_t>(IsoTpPci::CONSECUTIVE) << 4) | mSequence;
+    std::memcpy(frame + 1, mBuffer.data() + mSent, chunk);
+
+    if (!mSendFrame(frame, isoTpPaddedLength(1 + chunk, mFrameSize))) {
+        return false;
+    }
+
+    mSent += chunk;
+    mSequence = (mSequence + 1) & 0x0f;
+    return true;
+}
+
+void IsoTpSender::countStartFailure(void)
+{
+    // errno is left for the caller, which retries the message on a full queue.
+    const int error = errno;
+    if (error == ENOBUFS || error == EAGAIN) {
+        mStats.backoffs++;
+    } else {
+        mStats.aborted++;
+    }
+    errno = error;
+}
+
+void IsoTpSender::abort(void)
+{
+    mState = State::IDLE;
+    mStats.aborted++;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
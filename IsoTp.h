@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _IsoTp_H_
+#define _IsoTp_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include <inttypes.h>
+
+#include <linux/can.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * ISO 15765-2 (ISO-TP) segmentation and reassembly on top of raw CAN frames.
+ * Both classic CAN (8 byte frames) and CAN FD (up to 64 byte frames, long
+ * first frame escape) are supported. Messages are limited by the buffer
+ * preallocated at construction; nothing is allocated per message.
+ */
+enum class IsoTpPci : uint8_t {
+    SINGLE = 0,
+    FIRST = 1,
+    CONSECUTIVE = 2,
+    FLOW_CONTROL = 3,
+};
+
+constexpr uint8_t kIsoTpPadding = 0xCC;
+constexpr std::chrono::milliseconds kIsoTpTimeout {1000};   // N_As, N_Bs and N_Cr
+constexpr std::chrono::milliseconds kIsoTpMinBackoff {1};   // retry delays for a full TX queue
+constexpr std::chrono::milliseconds kIsoTpMaxBackoff {64};
+
+struct IsoTpStats {
+    std::atomic<uint64_t>   completed {0};  // whole messages transferred
+    std::atomic<uint64_t>   aborted {0};    // sequence errors, timeouts, overflows, send failures
+    std::atomic<uint64_t>   backoffs {0};   // frames to be retried on ENOBUFS/EAGAIN
+};
+
+inline IsoTpPci isoTpPci(const uint8_t* data) { return static_cast<IsoTpPci>(data[0] >> 4); }
+
+/**
+ * Receiving side of one ISO-TP connection. Flow control frames are sent
+ * through the callback given at construction.
+ */
+class IsoTpReceiver {
+public:
+    using SendFrame = std::function<bool(const uint8_t* data, size_t length)>;
+
+    enum class Result {
+        IN_PROGRESS,
+        COMPLETE,       // message() holds a whole message until the next frame
+        ERROR,
+    };
+
+    IsoTpReceiver(size_t maxMessageSize, uint8_t blockSize, uint8_t stMin, SendFrame sendFrame);
+
+    Result onFrame(const uint8_t* data, size_t length, int64_t timestamp);
+
+    const uint8_t* message(void) const { return mBuffer.data(); }
+    size_t messageLength(void) const { return mExpected; }
+    const IsoTpStats& stats(void) const { return mStats; }
+
+private:
+    Result onSingleFrame(const uint8_t* data, size_t length);
+    Result onFirstFrame(const uint8_t* data, size_t length, int64_t timestamp);
+    Result onConsecutiveFrame(const uint8_t* data, size_t length, int64_t timestamp);
+    void sendFlowControl(uint8_t status);
+    Result abort(void);
+
+    IsoTpStats              mStats;
+    std::vector<uint8_t>    mBuffer;
+    const uint8_t           mBlockSize;
+    const uint8_t           mStMin;
+    SendFrame               mSendFrame;
+    size_t                  mExpected;
+    size_t                  mReceived;
+    size_t                  mFrameSize;     // of the first frame, all but the last CF match it
+    uint8_t                 mSequence;
+    uint8_t                 mBlockLeft;
+    bool                    mInProgress;
+    int64_t                 mLastFrame;
+};
+
+/**
+ * Sending side of one ISO-TP connection. Not thread safe: start(), poll()
+ * and onFlowControl() run on one thread, which calls poll() again after the
+ * returned delay. A send callback failing with errno ENOBUFS or EAGAIN only
+ * delays the consecutive frame; the transfer is aborted if the queue stays
+ * full for kIsoTpTimeout.
+ */
+class IsoTpSender {
+public:
+    using SendFrame = std::function<bool(const uint8_t* data, size_t length)>;
+
+    IsoTpSender(size_t maxMessageSize, SendFrame sendFrame);
+
+    bool isIdle(void) const { return mState == State::IDLE; }
+
+    /*
+     * Copies the message and sends its single or first frame. frameSize is 8 or 64.
+     * On failure errno is ENOBUFS or EAGAIN if the message can be started again later.
+     */
+    bool start(const uint8_t* message, size_t length, size_t frameSize);
+    void onFlowControl(const uint8_t* data, size_t length);
+
+    /*
+     * Sends whatever is due and handles timeouts. Returns the delay until
+     * poll() is needed again, zero when idle or waiting for flow control
+     * without a pending deadline.
+     */
+    std::chrono::nanoseconds poll(void);
+
+    const IsoTpStats& stats(void) const { return mStats; }
+
+private:
+    enum class State {
+        IDLE,
+        WAIT_FLOW_CONTROL,
+        SENDING,
+    };
+
+    bool sendConsecutiveFrame(void);
+    void countStartFailure(void);
+    void abort(void);
+
+    IsoTpStats              mStats;
+    std::vector<uint8_t>    mBuffer;
+    SendFrame               mSendFrame;
+    State                   mState;
+    size_t                  mLength;
+    size_t                  mSent;
+    size_t                  mFrameSize;
+    uint8_t                 mSequence;
+    uint8_t                 mBlockSize;
+    uint8_t                 mBlockLeft;
+    std::chrono::nanoseconds mStMin;
+    std::chrono::nanoseconds mBackoff;
+    std::chrono::steady_clock::time_point mDeadline;    // next CF, or flow control timeout
+    std::chrono::steady_clock::time_point mStallDeadline;   // N_As while the TX queue is full
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _IsoTp_H_
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include <stdio.h>
+
+#include "LatencyStats.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (size_t i = 0; i < kBuckets; i++) {
+        mBuckets[i] += other.mBuckets[i];
+    }
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMax = std::max(mMax, other.mMax);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const
+{
+    const uint64_t rank = static_cast<uint64_t>(fraction * mCount);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += mBuckets[i];
+        if (seen > rank) {
+            return std::min(mMax, bucketLowerBound(i + 1) - 1);
+        }
+    }
+    return mMax;
+}
+
+std::mutex LatencyStats::sThreadsLock;
+std::vector<std::shared_ptr<LatencyStats::ThreadHistograms>> LatencyStats::sThreads;
+
+LatencyStats::ThreadHistograms& LatencyStats::threadHistograms(void)
+{
+    thread_local std::shared_ptr<ThreadHistograms> histograms;
+
+    if (histograms == nullptr) {
+        histograms = std::make_shared<ThreadHistograms>();
+        std::lock_guard<std::mutex> lock(sThreadsLock);
+        sThreads.push_back(histograms);
+    }
+    return *histograms;
+}
+
+void LatencyStats::record(LatencyStage stage, int32_t id, int64_t ns)
+{
+    ThreadHistograms& histograms = threadHistograms();
+    std::lock_guard<std::mutex> lock(histograms.lock);
+    histograms.stages[static_cast<size_t>(stage)][id].record(ns);
+}
+
+void LatencyStats::dump(int fd)
+{
+    static const char* const kStageNames[kLatencyStages] = {
+        "rx-to-event", "set", "can-tx", "timer", "timer-jitter"
+    };
+
+    std::map<int32_t, LatencyHistogram> merged[kLatencyStages];
+    {
+        std::lock_guard<std::mutex> lock(sThreadsLock);
+        for (auto& histograms : sThreads) {
+            std::lock_guard<std::mutex> threadLock(histograms->lock);
+            for (size_t stage = 0; stage < kLatencyStages; stage++) {
+                for (auto& it : histograms->stages[stage]) {
+                    merged[stage][it.first].merge(it.second);
+                }
+            }
+        }
+    }
+
+    dprintf(fd, "Latency, us: stage id count mean p50 p90 p99 p99.9 max\n");
+    for (size_t stage = 0; stage < kLatencyStages; stage++) {
+        LatencyHistogram total;
+        for (auto& it : merged[stage]) {
+            total.merge(it.second);
+        }
+
+        auto print = [fd, stage](const char* id, const LatencyHistogram& h) {
+            dprintf(fd, "%-12s %-10s %" PRIu64 " %.1f %.1f %.1f %.1f %.1f %.1f\n",
+                    kStageNames[stage], id, h.count(), h.mean() / 1000.0,
+                    h.percentile(0.5) / 1000.0, h.percentile(0.9) / 1000.0,
+                    h.percentile(0.99) / 1000.0, h.percentile(0.999) / 1000.0, h.max() / 1000.0);
+        };
+
+        print("all", total);
+        for (auto& it : merged[stage]) {
+            char id[16];
+            snprintf(id, sizeof(id), "0x%08x", it.first);
+            print(id, it.second);
+        }
+    }
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LatencyStats_H_
+#define _LatencyStats_H_
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <inttypes.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+enum class LatencyStage : uint8_t {
+    RX_TO_EVENT,    // per prop: CAN RX timestamp to doHalEvent()
+    SET,            // per prop: set() entry to return, the frame is queued by then
+    CAN_TX,         // per CAN ID: CanTxBytes() queueing to send() completion
+    TIMER,          // per prop: continuous property tick to doHalEvent()
+    TIMER_JITTER,   // TimerWheel wakeup past the tick it was armed for
+};
+
+constexpr size_t kLatencyStages = 5;
+
+/**
+ * Log-linear histogram of durations in nanoseconds: exact below 8 ns, then
+ * 8 buckets per power of two, so every bucket is within 12.5% of its values.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr unsigned kMaxShift = 36;   // longest distinct duration ~68 s
+    static constexpr size_t kBuckets = (kMaxShift - 1) * kSubBuckets;
+
+    void record(int64_t ns)
+    {
+        const uint64_t value = (ns > 0) ? static_cast<uint64_t>(ns) : 0;
+        mBuckets[bucketOf(value)]++;
+        mCount++;
+        mSum += value;
+        if (value > mMax) {
+            mMax = value;
+        }
+    }
+
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count(void) const { return mCount; }
+    uint64_t mean(void) const { return (mCount != 0) ? mSum / mCount : 0; }
+    uint64_t max(void) const { return mMax; }
+    /* Upper bound of the bucket holding the given fraction of the samples. */
+    uint64_t percentile(double fraction) const;
+
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        const unsigned msb = 63 - __builtin_clzll(value);
+        if (msb >= kMaxShift) {
+            return kBuckets - 1;
+        }
+        return (msb - 2) * kSubBuckets + ((value >> (msb - 3)) & (kSubBuckets - 1));
+    }
+
+    static uint64_t bucketLowerBound(size_t bucket)
+    {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        return (kSubBuckets + bucket % kSubBuckets) << (bucket / kSubBuckets - 1);
+    }
+
+private:
+    uint64_t    mBuckets[kBuckets] = {};
+    uint64_t    mCount = 0;
+    uint64_t    mSum = 0;
+    uint64_t    mMax = 0;
+};
+
+/**
+ * Always-on latency histograms per stage and per id. Every recording thread
+ * owns its histograms; the owner and dump() are the only users of their lock,
+ * so recording never waits for another recording thread.
+ */
+class LatencyStats {
+public:
+    static void record(LatencyStage stage, int32_t id, int64_t ns);
+    static void record(LatencyStage stage, int32_t id, std::chrono::steady_clock::time_point since)
+    {
+        record(stage, id, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - since).count());
+    }
+
+    /* Merges the histograms of all threads and writes percentiles as text to fd. */
+    static void dump(int fd);
+
+private:
+    struct ThreadHistograms {
+        std::mutex                                      lock;
+        std::unordered_map<int32_t, LatencyHistogram>   stages[kLatencyStages];
+    };
+
+    static ThreadHistograms& threadHistograms(void);
+
+    // Histograms outlive their threads, binder and timer threads come and go.
+    static std::mutex                                       sThreadsLock;
+    static std::vector<std::shared_ptr<ThreadHistograms>>   sThreads;
+};
+
+/* Records the lifetime of the scope, for functions with many returns. */
+class LatencyScope {
+public:
+    LatencyScope(LatencyStage stage, int32_t id) :
+        mStage(stage),
+        mId(id),
+        mStart(std::chrono::steady_clock::now()) {}
+    ~LatencyScope(void) { LatencyStats::record(mStage, mId, mStart); }
+
+private:
+    const LatencyStage                          mStage;
+    const int32_t                               mId;
+    const std::chrono::steady_clock::time_point mStart;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _LatencyStats_H_
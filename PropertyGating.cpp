@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <log/log.h>
+
+#include "PropertyGating.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+PropertyGating::PropertyGating(const StaticPropertyStore& store,
+                               const std::vector<PropertyGateDeclaration>& gates) :
+    mStore(store),
+    mRulesByControl(store.slotCount()),
+    mClosedGates(std::make_unique<std::atomic<uint16_t>[]>(store.slotCount()))
+{
+    for (size_t slot = 0; slot < store.slotCount(); slot++) {
+        mClosedGates[slot].store(0, std::memory_order_relaxed);
+    }
+
+    for (auto& gate : gates) {
+        const size_t controlSlot = store.slotOf(gate.controlProp, gate.controlArea);
+        if (controlSlot == StaticPropertyStore::kNoSlot) {
+            ALOGW("Gate on prop 0x%x area 0x%x: control not declared, ignored",
+                  gate.controlProp, gate.controlArea);
+            continue;
+        }
+
+        Rule rule = {
+            .controlSlot = controlSlot,
+            .minValue = gate.minValue,
+            .maxValue = gate.maxValue,
+            .gatedSlots = {},
+            .open = true,
+        };
+        for (int32_t prop : gate.gatedProps) {
+            const size_t first = store.firstSlotOf(prop);
+            if (first == StaticPropertyStore::kNoSlot) {
+                ALOGW("Gate on prop 0x%x: gated prop 0x%x not declared", gate.controlProp, prop);
+                continue;
+            }
+            for (size_t slot = first; slot < store.slotCount() && store.propOfSlot(slot) == prop; slot++) {
+                rule.gatedSlots.push_back(slot);
+            }
+        }
+
+        mRulesByControl[controlSlot].push_back(mRules.size());
+        mRules.push_back(std::move(rule));
+    }
+
+    ALOGI("Property gating: %zu rules", mRules.size());
+}
+
+bool PropertyGating::evaluate(const Rule& rule) const
+{
+    int32_t value;
+    if (!mStore.readSlotInt32(rule.controlSlot, &value)) {
+        return true;
+    }
+    return value >= rule.minValue && value <= rule.maxValue;
+}
+
+void PropertyGating::apply(Rule& rule, bool open, std::vector<Change>* changes)
+{
+    if (rule.open == open) {
+        return;
+    }
+    rule.open = open;
+
+    for (uint16_t slot : rule.gatedSlots) {
+        // Only the first gate to close and the last to open change availability.
+        const uint16_t closed = open ? mClosedGates[slot].fetch_sub(1, std::memory_order_acq_rel)
+                                     : mClosedGates[slot].fetch_add(1, std::memory_order_acq_rel);
+        if (changes != nullptr && closed == (open ? 1 : 0)) {
+            changes->push_back({slot, open});
+        }
+    }
+}
+
+void PropertyGating::update(size_t controlSlot, std::vector<Change>& changes)
+{
+    // The stored value is read under the lock, so concurrent writers of the
+    // control settle on whatever the store ends up holding.
+    std::lock_guard<std::mutex> lock(mLock);
+    for (uint16_t index : mRulesByControl[controlSlot]) {
+        apply(mRules[index], evaluate(mRules[index]), &changes);
+    }
+}
+
+void PropertyGating::refresh(void)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto& rule : mRules) {
+        apply(rule, evaluate(rule), nullptr);
+    }
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
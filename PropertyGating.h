@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PropertyGating_H_
+#define _PropertyGating_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "StaticPropertyStore.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * The gated properties, in all their areas, are not available while the
+ * control (prop, area) holds a single int32 outside [minValue, maxValue].
+ * A control without a value leaves them available.
+ */
+struct PropertyGateDeclaration {
+    int32_t                 controlProp;
+    int32_t                 controlArea;
+    int32_t                 minValue;
+    int32_t                 maxValue;
+    std::vector<int32_t>    gatedProps;
+};
+
+/*
+ * Availability of store slots under a set of PropertyGateDeclarations.
+ *
+ * Every slot keeps the number of its closed gates, so isAvailable() is one
+ * load whatever the number of rules. Rules are only re-evaluated by
+ * update(), called after a write to their control slot, which reports the
+ * slots whose availability flipped.
+ */
+class PropertyGating {
+public:
+    struct Change {
+        size_t  slot;
+        bool    available;
+    };
+
+    PropertyGating(const StaticPropertyStore& store, const std::vector<PropertyGateDeclaration>& gates);
+
+    bool isAvailable(size_t slot) const { return mClosedGates[slot].load(std::memory_order_acquire) == 0; }
+    /* Whether writes to the slot can change the availability of others. */
+    bool controls(size_t slot) const { return !mRulesByControl[slot].empty(); }
+
+    /* Re-evaluates the rules of controlSlot from its stored value, appends what flipped to changes. */
+    void update(size_t controlSlot, std::vector<Change>& changes);
+    /* Re-evaluates every rule, e.g. once the initial values are stored. Nothing is reported. */
+    void refresh(void);
+
+    size_t ruleCount(void) const { return mRules.size(); }
+
+private:
+    struct Rule {
+        size_t                  controlSlot;
+        int32_t                 minValue;
+        int32_t                 maxValue;
+        std::vector<uint16_t>   gatedSlots;
+        bool                    open;
+    };
+
+    bool evaluate(const Rule& rule) const;
+    void apply(Rule& rule, bool open, std::vector<Change>* changes);
+
+    const StaticPropertyStore&              mStore;
+    std::vector<Rule>                       mRules;
+    std::vector<std::vector<uint16_t>>      mRulesByControl;    // per slot
+    std::unique_ptr<std::atomic<uint16_t>[]> mClosedGates;      // per slot
+    std::mutex                              mLock;              // rule evaluation
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _PropertyGating_H_
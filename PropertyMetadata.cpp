@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <log/log.h>
+
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "DefaultCanConfig.h"
+#include "PropertyMetadata.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+PropertyMetadataTable::PropertyMetadataTable(const StaticPropertyStore& store) :
+    mStore(store)
+{
+    mEntries.reserve(store.slotCount());
+    for (size_t slot = 0; slot < store.slotCount(); slot++) {
+        const int32_t prop = store.propOfSlot(slot);
+        const VehiclePropConfig& config = *store.getConfigOrNull(prop);
+        const size_t firstSlot = store.firstSlotOf(prop);
+
+        size_t areaCount = 1;
+        while (firstSlot + areaCount < store.slotCount()
+                && store.propOfSlot(firstSlot + areaCount) == prop) {
+            areaCount++;
+        }
+
+        mEntries.push_back(PropertyMetadata {
+            .prop = prop,
+            .areaId = store.areaOfSlot(slot),
+            .changeMode = config.changeMode,
+            .access = config.access,
+            .valueType = getPropType(prop),
+            .firstSlot = static_cast<uint16_t>(firstSlot),
+            .areaCount = static_cast<uint16_t>(areaCount),
+            .minSampleRate = config.minSampleRate,
+            .maxSampleRate = config.maxSampleRate,
+            .canMessage = PropertyMetadata::kNone,
+        });
+    }
+
+    // The first message carrying a (prop, area) encodes it, as the old scan of set() did.
+    size_t signalSlots = 0;
+    for (size_t m = 0; m < kCanMessages.size(); m++) {
+        const CanMessage& message = kCanMessages[m];
+        for (size_t i = message.firstSignal; i < message.firstSignal + message.signalCount; i++) {
+            const size_t slot = store.slotOf(kCanSignals[i].prop, kCanSignals[i].areaId);
+            if (slot == StaticPropertyStore::kNoSlot) {
+                ALOGW("CAN signal 0x%x/0x%x: property not declared", kCanSignals[i].prop,
+                      kCanSignals[i].areaId);
+                continue;
+            }
+            if (mEntries[slot].canMessage == PropertyMetadata::kNone) {
+                mEntries[slot].canMessage = m;
+                signalSlots++;
+            }
+        }
+    }
+
+    ALOGI("Property metadata: %zu slots, %zu carried by CAN signals", mEntries.size(), signalSlots);
+}
+
+const PropertyMetadata* PropertyMetadataTable::find(int32_t prop) const
+{
+    const size_t slot = mStore.firstSlotOf(prop);
+    return (slot != StaticPropertyStore::kNoSlot) ? &mEntries[slot] : nullptr;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PropertyMetadata_H_
+#define _PropertyMetadata_H_
+
+#include <vector>
+
+#include <inttypes.h>
+
+#include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
+
+#include "StaticPropertyStore.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* What the hot paths need to know about one (prop, area) slot, in one place. */
+struct PropertyMetadata {
+    static constexpr uint16_t kNone = UINT16_MAX;
+
+    int32_t                     prop;
+    int32_t                     areaId;
+    VehiclePropertyChangeMode   changeMode;
+    VehiclePropertyAccess       access;
+    VehiclePropertyType         valueType;
+    uint16_t                    firstSlot;      // the areas of the property are the slots
+    uint16_t                    areaCount;      // [firstSlot, firstSlot + areaCount)
+    float                       minSampleRate;
+    float                       maxSampleRate;
+    uint16_t                    canMessage;     // kCanMessages index carrying the signal, or kNone
+};
+
+/*
+ * PropertyMetadata of every slot of a StaticPropertyStore, built once from
+ * the store and kCanSignals. Lookups are the store's perfect hash plus one
+ * array load, instead of config and signal scans. Availability, which
+ * changes at run time, is kept by PropertyGating.
+ */
+class PropertyMetadataTable {
+public:
+    explicit PropertyMetadataTable(const StaticPropertyStore& store);
+
+    const PropertyMetadata& at(size_t slot) const { return mEntries[slot]; }
+    /* The first area of the property, nullptr if it has no slots. */
+    const PropertyMetadata* find(int32_t prop) const;
+
+private:
+    const StaticPropertyStore&      mStore;
+    std::vector<PropertyMetadata>   mEntries;   // per slot
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _PropertyMetadata_H_
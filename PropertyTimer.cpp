@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <log/log.h>
+
+#include "PropertyTimer.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+PropertyTimer::PropertyTimer(EventLoop& loop, const Action& action) :
+    mAction(action),
+    mTimerFd(loop.addTimer(std::bind(&PropertyTimer::onTimer, this)))
+{
+}
+
+PropertyTimer::~PropertyTimer(void)
+{
+    // The owner stops the loop before destroying the timer.
+    if (mTimerFd != -1) {
+        close(mTimerFd);
+    }
+}
+
+void PropertyTimer::registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mEvents[cookie] = RecurrentEvent {
+        .interval = interval,
+        .deadline = Clock::now() + interval
+    };
+    rearmLocked();
+}
+
+void PropertyTimer::unregisterRecurrentEvent(int32_t cookie)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mEvents.erase(cookie) != 0) {
+        rearmLocked();
+    }
+}
+
+void PropertyTimer::onTimer(void)
+{
+    std::vector<int32_t> cookies;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto now = Clock::now();
+
+        for (auto& it : mEvents) {
+            RecurrentEvent& event = it.second;
+            if (event.deadline > now) {
+                continue;
+            }
+
+            cookies.push_back(it.first);
+
+            // Skip periods missed while the loop was busy instead of bursting.
+            auto missed = (now - event.deadline) / event.interval;
+            event.deadline += event.interval * (missed + 1);
+        }
+
+        rearmLocked();
+    }
+
+    if (!cookies.empty()) {
+        mAction(cookies);
+    }
+}
+
+void PropertyTimer::rearmLocked(void)
+{
+    if (mTimerFd == -1) {
+        return;
+    }
+
+    struct itimerspec spec = {};    // all zero disarms
+
+    if (!mEvents.empty()) {
+        auto next = mEvents.begin()->second.deadline;
+        for (auto& it : mEvents) {
+            next = std::min(next, it.second.deadline);
+        }
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch());
+        spec.it_value.tv_sec = ns.count() / 1000000000;
+        spec.it_value.tv_nsec = ns.count() % 1000000000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        ALOGE("timerfd_settime failed (error %d)", errno);
+    }
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PropertyTimer_H_
+#define _PropertyTimer_H_
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "EventLoop.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * Drop-in replacement of RecurrentTimer that runs on an EventLoop timerfd
+ * instead of its own thread. Events may be (un)registered from any thread;
+ * the action is called on the loop thread with all cookies due at once.
+ *
+ * Every expiration and every (un)registration scans all events. The HAL
+ * uses TimerWheel instead; this one is the baseline of
+ * benchmarks/TimerBenchmark.cpp.
+ */
+class PropertyTimer {
+public:
+    using Action = std::function<void(const std::vector<int32_t>& cookies)>;
+
+    PropertyTimer(EventLoop& loop, const Action& action);
+    ~PropertyTimer(void);
+
+    void registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie);
+    void unregisterRecurrentEvent(int32_t cookie);
+
+private:
+    using Clock = std::chrono::steady_clock;   // CLOCK_MONOTONIC, as the timerfd
+
+    struct RecurrentEvent {
+        std::chrono::nanoseconds    interval;
+        Clock::time_point           deadline;
+    };
+
+    void onTimer(void);
+    void rearmLocked(void);
+
+    Action                                      mAction;
+    int                                         mTimerFd;
+    std::mutex                                  mLock;
+    std::unordered_map<int32_t, RecurrentEvent> mEvents;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _PropertyTimer_H_
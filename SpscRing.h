@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SpscRing_H_
+#define _SpscRing_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * Bounded lock-free ring for exactly one producer and one consumer thread.
+ * Records are preallocated and filled in place:
+ *
+ *   producer: if (T* rec = ring.acquire()) { fill(*rec); ring.publish(); }
+ *   consumer: while (T* rec = ring.peek()) { use(*rec); ring.release(); }
+ */
+template <typename T>
+class SpscRing {
+public:
+    /* Capacity is rounded up to a power of two. */
+    explicit SpscRing(size_t capacity) :
+        mHead(0),
+        mCachedTail(0),
+        mTail(0),
+        mCachedHead(0)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mSlots.resize(size);
+        mMask = size - 1;
+    }
+
+    size_t capacity(void) const { return mSlots.size(); }
+
+    /* Producer: next free record, or nullptr if the ring is full. */
+    T* acquire(void)
+    {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mCachedTail == mSlots.size()) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (head - mCachedTail == mSlots.size()) {
+                return nullptr;
+            }
+        }
+        return &mSlots[head & mMask];
+    }
+
+    /* Producer: makes the record returned by acquire() visible to the consumer. */
+    void publish(void)
+    {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /* Consumer: oldest published record, or nullptr if the ring is empty. */
+    T* peek(void)
+    {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mCachedHead) {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            if (tail == mCachedHead) {
+                return nullptr;
+            }
+        }
+        return &mSlots[tail & mMask];
+    }
+
+    /* Consumer: hands the record returned by peek() back to the producer. */
+    void release(void)
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    // Each index lives on its own cache line together with the copy of the
+    // other index cached by the same thread, so the sides only share a line
+    // when they actually have to synchronize.
+    alignas(64) std::atomic<size_t> mHead;      // written by the producer
+    size_t                          mCachedTail;
+    alignas(64) std::atomic<size_t> mTail;      // written by the consumer
+    size_t                          mCachedHead;
+    alignas(64) std::vector<T>      mSlots;
+    size_t                          mMask;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _SpscRing_H_
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+#include <log/log.h>
+
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "DefaultConfig.h"
+#include "StaticPropertyStore.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+// Table entries per key and keys per bucket. At half load every bucket finds
+// a free seed within a few tries.
+static constexpr size_t kTableLoadDivisor = 2;
+static constexpr size_t kKeysPerBucket = 2;
+
+// A reader that keeps seeing a write in progress, e.g. because the writer was
+// preempted in the middle, waits on the slot lock instead of spinning on.
+static constexpr int kMaxOptimisticReads = 64;
+
+// Snapshot header: area id in the low half, then the layout of the payload.
+static constexpr uint64_t kHasValue = 1ULL << 32;
+static constexpr uint64_t kPublished = 1ULL << 33;     // the payload holds the value
+static constexpr int kStatusShift = 36;
+static constexpr int kInt32CountShift = 40;
+static constexpr int kFloatCountShift = 44;
+static constexpr int kInt64CountShift = 48;
+static constexpr uint64_t kFieldMask = 0xf;
+
+static std::vector<VehiclePropConfig> defaultConfigs(void)
+{
+    std::vector<VehiclePropConfig> configs;
+    for (auto& it : kVehicleProperties) {
+        configs.push_back(it.config);
+    }
+    return configs;
+}
+
+static size_t nextPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+StaticPropertyStore::StaticPropertyStore(void) :
+    StaticPropertyStore(defaultConfigs())
+{
+}
+
+StaticPropertyStore::StaticPropertyStore(const std::vector<VehiclePropConfig>& configs) :
+    mSlotCount(0)
+{
+    std::vector<Key> configKeys;
+    std::set<int32_t> declared;
+    std::set<std::pair<int32_t, int32_t>> seen;
+
+    for (auto& config : configs) {
+        if (!declared.insert(config.prop).second) {
+            continue;
+        }
+        configKeys.push_back({config.prop, 0});
+        mConfigs.push_back(config);
+        mFirstSlots.push_back(kNoSlot);
+
+        if (isGlobalProp(config.prop)) {
+            mFirstSlots.back() = mSlotKeys.size();
+            mSlotKeys.push_back({config.prop, 0});
+            continue;
+        }
+        for (auto& areaConfig : config.areaConfigs) {
+            if (seen.insert({config.prop, areaConfig.areaId}).second) {
+                if (mFirstSlots.back() == kNoSlot) {
+                    mFirstSlots.back() = mSlotKeys.size();
+                }
+                mSlotKeys.push_back({config.prop, areaConfig.areaId});
+            }
+        }
+    }
+
+    LOG_ALWAYS_FATAL_IF(mSlotKeys.size() >= PerfectHash::kEmpty,
+                        "%zu property slots, at most %u are supported",
+                        mSlotKeys.size(), PerfectHash::kEmpty - 1);
+
+    mSlotCount = mSlotKeys.size();
+    mSlots = std::make_unique<Slot[]>(mSlotCount);
+    mSlotHash.build(mSlotKeys);
+    mConfigHash.build(configKeys);
+
+    ALOGI("Property store: %zu properties, %zu slots, %zu hash entries, %zu buckets",
+          mConfigs.size(), mSlotCount, mSlotHash.keys.size(), mSlotHash.seeds.size());
+}
+
+void StaticPropertyStore::PerfectHash::build(const std::vector<Key>& input)
+{
+    const size_t tableSize = nextPowerOfTwo(std::max<size_t>(input.size() * kTableLoadDivisor, 1));
+    const size_t bucketCount = nextPowerOfTwo(std::max<size_t>(input.size() / kKeysPerBucket, 1));
+    const uint32_t bucketMask = bucketCount - 1;
+
+    tableMask = tableSize - 1;
+    seeds.assign(bucketCount, 0);
+    keys.assign(tableSize, Key {0, 0});
+    indexes.assign(tableSize, kEmpty);
+
+    std::vector<std::vector<uint16_t>> buckets(bucketCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        buckets[propertySlotHash(input[i].prop, input[i].areaId, 0) & bucketMask].push_back(i);
+    }
+
+    // Crowded buckets first, while the table still has room for them.
+    std::vector<uint32_t> order(bucketCount);
+    for (size_t i = 0; i < bucketCount; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<uint32_t> positions;
+    for (uint32_t bucket : order) {
+        const std::vector<uint16_t>& members = buckets[bucket];
+        if (members.empty()) {
+            break;
+        }
+
+        for (uint32_t seed = 1; ; seed++) {
+            positions.clear();
+            for (uint16_t index : members) {
+                const uint32_t position = propertySlotHash(input[index].prop, input[index].areaId, seed)
+                        & tableMask;
+                if (indexes[position] != kEmpty
+                        || std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                    break;
+                }
+                positions.push_back(position);
+            }
+            if (positions.size() != members.size()) {
+                continue;
+            }
+
+            for (size_t i = 0; i < members.size(); i++) {
+                keys[positions[i]] = input[members[i]];
+                indexes[positions[i]] = members[i];
+            }
+            seeds[bucket] = seed;
+            break;
+        }
+    }
+}
+
+size_t StaticPropertyStore::PerfectHash::find(int32_t prop, int32_t areaId) const
+{
+    const uint32_t seed = seeds[propertySlotHash(prop, areaId, 0) & (seeds.size() - 1)];
+    const uint32_t position = propertySlotHash(prop, areaId, seed) & tableMask;
+    const Key& key = keys[position];
+
+    return (indexes[position] != kEmpty && key.prop == prop && key.areaId == areaId)
+            ? indexes[position] : kNoSlot;
+}
+
+size_t StaticPropertyStore::slotOf(int32_t prop, int32_t areaId) const
+{
+    return mSlotHash.find(prop, isGlobalProp(prop) ? 0 : areaId);
+}
+
+size_t StaticPropertyStore::firstSlotOf(int32_t prop) const
+{
+    const size_t index = mConfigHash.find(prop, 0);
+    return (index != kNoSlot) ? mFirstSlots[index] : kNoSlot;
+}
+
+std::unique_ptr<VehiclePropValue> StaticPropertyStore::readValueOrNull(
+        const VehiclePropValue& request) const
+{
+    return readValueOrNull(request.prop, request.areaId);
+}
+
+std::unique_ptr<VehiclePropValue> StaticPropertyStore::readValueOrNull(int32_t prop,
+                                                                       int32_t areaId) const
+{
+    const size_t slot = slotOf(prop, areaId);
+    return (slot != kNoSlot) ? readSlotOrNull(slot) : nullptr;
+}
+
+std::unique_ptr<VehiclePropValue> StaticPropertyStore::readSlotOrNull(size_t slot) const
+{
+    const Slot& entry = mSlots[slot];
+    uint64_t snapshot[kSnapshotWords];
+    if (readSnapshot(entry, snapshot)) {
+        if (!(snapshot[0] & kHasValue)) {
+            return nullptr;
+        }
+        if (snapshot[0] & kPublished) {
+            return fromSnapshot(mSlotKeys[slot].prop, snapshot);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(entry.lock);
+    return entry.hasValue ? std::make_unique<VehiclePropValue>(entry.value) : nullptr;
+}
+
+bool StaticPropertyStore::readSlotInt32(size_t slot, int32_t* value) const
+{
+    const Slot& entry = mSlots[slot];
+    uint64_t snapshot[kSnapshotWords];
+    if (readSnapshot(entry, snapshot)) {
+        const uint64_t header = snapshot[0];
+        if (!(header & kHasValue)) {
+            return false;
+        }
+        if (header & kPublished) {
+            if (((header >> kInt32CountShift) & kFieldMask) != 1) {
+                return false;
+            }
+            std::memcpy(value, &snapshot[2], sizeof(*value));
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(entry.lock);
+    if (!entry.hasValue || entry.value.value.int32Values.size() != 1) {
+        return false;
+    }
+    *value = entry.value.value.int32Values[0];
+    return true;
+}
+
+bool StaticPropertyStore::readSnapshot(const Slot& entry, uint64_t* snapshot)
+{
+    for (int attempt = 0; attempt < kMaxOptimisticReads; attempt++) {
+        const uint32_t seq = entry.seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        for (size_t i = 0; i < kSnapshotWords; i++) {
+            snapshot[i] = entry.snapshot[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.seq.load(std::memory_order_relaxed) == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<VehiclePropValue> StaticPropertyStore::fromSnapshot(int32_t prop,
+                                                                    const uint64_t* snapshot)
+{
+    const uint64_t header = snapshot[0];
+    auto value = std::make_unique<VehiclePropValue>();
+    value->prop = prop;
+    value->areaId = static_cast<int32_t>(header);
+    value->timestamp = static_cast<int64_t>(snapshot[1]);
+    value->status = static_cast<VehiclePropertyStatus>((header >> kStatusShift) & kFieldMask);
+
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(&snapshot[2]);
+    value->value.int32Values.resize((header >> kInt32CountShift) & kFieldMask);
+    value->value.floatValues.resize((header >> kFloatCountShift) & kFieldMask);
+    value->value.int64Values.resize((header >> kInt64CountShift) & kFieldMask);
+
+    // Empty vectors may have a null data(), which memcpy must not see even for 0 bytes.
+    size_t offset = 0;
+    if (!value->value.int32Values.empty()) {
+        std::memcpy(value->value.int32Values.data(), payload + offset,
+                    value->value.int32Values.size() * sizeof(int32_t));
+        offset += value->value.int32Values.size() * sizeof(int32_t);
+    }
+    if (!value->value.floatValues.empty()) {
+        std::memcpy(value->value.floatValues.data(), payload + offset,
+                    value->value.floatValues.size() * sizeof(float));
+        offset += value->value.floatValues.size() * sizeof(float);
+    }
+    if (!value->value.int64Values.empty()) {
+        std::memcpy(value->value.int64Values.data(), payload + offset,
+                    value->value.int64Values.size() * sizeof(int64_t));
+    }
+    return value;
+}
+
+void StaticPropertyStore::publish(Slot& entry)
+{
+    const VehiclePropValue& value = entry.value;
+    const size_t int32Bytes = value.value.int32Values.size() * sizeof(int32_t);
+    const size_t floatBytes = value.value.floatValues.size() * sizeof(float);
+    const size_t int64Bytes = value.value.int64Values.size() * sizeof(int64_t);
+
+    uint64_t snapshot[kSnapshotWords] = {};
+    snapshot[0] = static_cast<uint32_t>(value.areaId) | kHasValue;
+    snapshot[1] = static_cast<uint64_t>(value.timestamp);
+
+    const bool fits = value.value.bytes.size() == 0 && value.value.stringValue.size() == 0
+            && value.value.int32Values.size() <= kFieldMask
+            && value.value.floatValues.size() <= kFieldMask
+            && value.value.int64Values.size() <= kFieldMask
+            && int32Bytes + floatBytes + int64Bytes <= kPayloadBytes
+            && static_cast<uint64_t>(value.status) <= kFieldMask;
+    if (fits) {
+        snapshot[0] |= kPublished
+                | static_cast<uint64_t>(value.status) << kStatusShift
+                | static_cast<uint64_t>(value.value.int32Values.size()) << kInt32CountShift
+                | static_cast<uint64_t>(value.value.floatValues.size()) << kFloatCountShift
+                | static_cast<uint64_t>(value.value.int64Values.size()) << kInt64CountShift;
+
+        uint8_t* payload = reinterpret_cast<uint8_t*>(&snapshot[2]);
+        if (int32Bytes != 0) {
+            std::memcpy(payload, value.value.int32Values.data(), int32Bytes);
+        }
+        if (floatBytes != 0) {
+            std::memcpy(payload + int32Bytes, value.value.floatValues.data(), floatBytes);
+        }
+        if (int64Bytes != 0) {
+            std::memcpy(payload + int32Bytes + floatBytes, value.value.int64Values.data(), int64Bytes);
+        }
+    }
+
+    // Writers of the slot are serialized by its lock, so the sequence has a single writer.
+    const uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+    entry.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kSnapshotWords; i++) {
+        entry.snapshot[i].store(snapshot[i], std::memory_order_relaxed);
+    }
+    entry.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool StaticPropertyStore::writeValue(const VehiclePropValue& propValue, bool updateStatus)
+{
+    const size_t slot = slotOf(propValue.prop, propValue.areaId);
+    if (slot == kNoSlot) {
+        return false;
+    }
+
+    Slot& entry = mSlots[slot];
+    std::lock_guard<std::mutex> lock(entry.lock);
+
+    if (!entry.hasValue) {
+        entry.value = propValue;
+        entry.hasValue = true;
+        publish(entry);
+        return true;
+    }
+    if (entry.value.timestamp > propValue.timestamp) {
+        return false;   // Outdated
+    }
+
+    entry.value.timestamp = propValue.timestamp;
+    entry.value.value = propValue.value;
+    if (updateStatus) {
+        entry.value.status = propValue.status;
+    }
+    publish(entry);
+    return true;
+}
+
+const VehiclePropConfig* StaticPropertyStore::getConfigOrNull(int32_t prop) const
+{
+    const size_t index = mConfigHash.find(prop, 0);
+    return (index != kNoSlot) ? &mConfigs[index] : nullptr;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
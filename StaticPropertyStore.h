@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _StaticPropertyStore_H_
+#define _StaticPropertyStore_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <inttypes.h>
+
+#include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* Mixes (prop, area) with a seed; the perfect hash below is built from it. */
+constexpr uint32_t propertySlotHash(int32_t prop, int32_t areaId, uint32_t seed) {
+    uint64_t x = (uint64_t(uint32_t(prop)) << 32 | uint32_t(areaId)) ^ (seed * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<uint32_t>(x);
+}
+
+/**
+ * Property store for a property set fixed at construction, by default
+ * kVehicleProperties. It keeps the readValueOrNull() / writeValue()
+ * semantics of VehiclePropertyStore, but:
+ *
+ *  - every (prop, area) of the table owns a dense slot, found through a
+ *    hash-and-displace perfect hash: two hashes, two array loads and a key
+ *    compare, no tree walk;
+ *  - slots are cache line aligned and locked one by one, so readers and
+ *    writers of different properties never meet;
+ *  - a value of a few scalars (everything but bytes, strings and long
+ *    vectors) is also published in its slot under a sequence lock, and
+ *    readers copy it without taking the slot lock, retrying if a writer
+ *    got in between. Only writers of the same slot contend.
+ *
+ * Values of (prop, area) pairs that are not declared are not stored.
+ */
+class StaticPropertyStore {
+public:
+    static constexpr size_t kNoSlot = SIZE_MAX;
+
+    /* The properties of kVehicleProperties. */
+    StaticPropertyStore(void);
+    /* Later declarations of the same property are ignored, as registerProperty() does. */
+    explicit StaticPropertyStore(const std::vector<VehiclePropConfig>& configs);
+
+    /* Dense index of (prop, area), kNoSlot if it is not in the table. Global properties use area 0. */
+    size_t slotOf(int32_t prop, int32_t areaId) const;
+    size_t slotCount(void) const { return mSlotCount; }
+    /* The slots of a property are contiguous; kNoSlot if it is undeclared or has no areas. */
+    size_t firstSlotOf(int32_t prop) const;
+    int32_t propOfSlot(size_t slot) const { return mSlotKeys[slot].prop; }
+    int32_t areaOfSlot(size_t slot) const { return mSlotKeys[slot].areaId; }
+
+    std::unique_ptr<VehiclePropValue> readValueOrNull(const VehiclePropValue& request) const;
+    std::unique_ptr<VehiclePropValue> readValueOrNull(int32_t prop, int32_t areaId = 0) const;
+    std::unique_ptr<VehiclePropValue> readSlotOrNull(size_t slot) const;
+    /* The value of a slot holding a single int32, without a copy. False for anything else. */
+    bool readSlotInt32(size_t slot, int32_t* value) const;
+
+    /*
+     * Stores propValue unless its slot holds a newer value. The status is
+     * kept unless updateStatus is set. False for undeclared (prop, area) pairs.
+     */
+    bool writeValue(const VehiclePropValue& propValue, bool updateStatus);
+
+    std::vector<VehiclePropConfig> getAllConfigs(void) const { return mConfigs; }
+    const VehiclePropConfig* getConfigOrNull(int32_t prop) const;
+
+private:
+    // Header, timestamp and payload of the published copy; one cache line with the sequence.
+    static constexpr size_t kSnapshotWords = 7;
+    static constexpr size_t kPayloadBytes = (kSnapshotWords - 2) * sizeof(uint64_t);
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t>   seq {0};    // odd while a writer updates the snapshot
+        std::atomic<uint64_t>   snapshot[kSnapshotWords] {};
+        mutable std::mutex      lock;       // writers, and readers of values too big to publish
+        bool                    hasValue = false;
+        VehiclePropValue        value;
+    };
+
+    struct Key {
+        int32_t     prop;
+        int32_t     areaId;
+    };
+
+    /*
+     * Hash-and-displace perfect hash: the bucket of a key picks the seed of
+     * its second hash, which leads to a table entry holding the key and the
+     * index it was given at build time.
+     */
+    struct PerfectHash {
+        static constexpr uint16_t kEmpty = UINT16_MAX;
+
+        void build(const std::vector<Key>& keys);
+        size_t find(int32_t prop, int32_t areaId) const;
+
+        std::vector<uint32_t>   seeds;      // per bucket
+        std::vector<Key>        keys;       // per table entry
+        std::vector<uint16_t>   indexes;    // per table entry, kEmpty if unused
+        uint32_t                tableMask = 0;
+    };
+    static void publish(Slot& entry);
+    static bool readSnapshot(const Slot& entry, uint64_t* snapshot);
+    static std::unique_ptr<VehiclePropValue> fromSnapshot(int32_t prop, const uint64_t* snapshot);
+
+    std::vector<VehiclePropConfig>      mConfigs;
+    std::vector<size_t>                 mFirstSlots;    // per config, kNoSlot if it has no areas
+    PerfectHash                         mConfigHash;    // (prop, 0) -> mConfigs index
+    size_t                              mSlotCount;
+    std::unique_ptr<Slot[]>             mSlots;
+    std::vector<Key>                    mSlotKeys;      // per slot
+    PerfectHash                         mSlotHash;      // (prop, area) -> slot
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _StaticPropertyStore_H_
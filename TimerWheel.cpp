@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <log/log.h>
+
+#include "LatencyStats.h"
+#include "TimerWheel.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * Distance from start to the first set bit of the ring of bits bits in
+ * words, wrapping around, or -1 if none is set.
+ */
+static int nextSetBit(const uint64_t* words, size_t bits, size_t start)
+{
+    size_t position = start;
+    size_t remaining = bits;
+
+    while (remaining > 0) {
+        const size_t bit = position % 64;
+        const size_t span = std::min({64 - bit, remaining, bits - position});
+        uint64_t word = words[position / 64] >> bit;
+        if (span < 64) {
+            word &= (1ULL << span) - 1;
+        }
+        if (word != 0) {
+            return (position + __builtin_ctzll(word) + bits - start) % bits;
+        }
+        position = (position + span) % bits;
+        remaining -= span;
+    }
+    return -1;
+}
+
+TimerWheel::TimerWheel(EventLoop& loop, const Action& action) :
+    mAction(action),
+    mTimerFd(loop.addTimer(std::bind(&TimerWheel::onTimer, this))),
+    mEpoch(Clock::now()),
+    mCurrent(0),
+    mArmedTick(0),
+    mOccupied {},
+    mStats {}
+{
+    std::fill(std::begin(mHeads), std::end(mHeads), kNil);
+}
+
+TimerWheel::~TimerWheel(void)
+{
+    // The owner stops the loop before destroying the timer.
+    if (mTimerFd != -1) {
+        close(mTimerFd);
+    }
+}
+
+uint64_t TimerWheel::tickOf(Clock::time_point time) const
+{
+    return (time > mEpoch) ? (time - mEpoch) / kTick : 0;
+}
+
+TimerWheel::Clock::time_point TimerWheel::timeOf(uint64_t tick) const
+{
+    return mEpoch + kTick * tick;
+}
+
+void TimerWheel::registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    const uint64_t now = tickOf(Clock::now());
+    if (mIndex.empty()) {
+        mCurrent = now;     // nothing to catch up with
+    }
+
+    auto it = mIndex.find(cookie);
+    uint32_t index;
+    if (it != mIndex.end()) {
+        index = it->second;
+        unlinkLocked(index);
+    } else if (!mFree.empty()) {
+        index = mFree.back();
+        mFree.pop_back();
+    } else {
+        index = mEntries.size();
+        mEntries.emplace_back();
+    }
+    mIndex[cookie] = index;
+
+    Entry& entry = mEntries[index];
+    entry.cookie = cookie;
+    entry.interval = std::max<uint64_t>(1, (interval + kTick / 2) / kTick);
+    entry.due = (now / entry.interval + 1) * entry.interval;
+    insertLocked(index);
+
+    if (mArmedTick == 0 || entry.due < mArmedTick) {
+        rearmLocked();
+    }
+}
+
+void TimerWheel::unregisterRecurrentEvent(int32_t cookie)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mIndex.find(cookie);
+    if (it == mIndex.end()) {
+        return;
+    }
+    unlinkLocked(it->second);
+    mFree.push_back(it->second);
+    mIndex.erase(it);
+    // The timerfd stays armed; an expiration with nothing due rearms it.
+}
+
+void TimerWheel::insertLocked(uint32_t index)
+{
+    Entry& entry = mEntries[index];
+    const uint64_t delta = (entry.due > mCurrent) ? entry.due - mCurrent : 0;
+
+    size_t bucket;
+    if (delta < kLevel0Size) {
+        bucket = entry.due % kLevel0Size;
+    } else if (delta < (1ULL << kLevel2Shift)) {
+        bucket = kLevel1Base + (entry.due >> kLevel1Shift) % kLevelSize;
+    } else {
+        // Beyond the horizon the entry goes as far as it can and is cascaded again from there.
+        const uint64_t reach = std::min(entry.due, mCurrent + kHorizon - 1);
+        bucket = kLevel2Base + (reach >> kLevel2Shift) % kLevelSize;
+    }
+
+    entry.bucket = bucket;
+    entry.prev = kNil;
+    entry.next = mHeads[bucket];
+    if (entry.next != kNil) {
+        mEntries[entry.next].prev = index;
+    }
+    mHeads[bucket] = index;
+    mOccupied[bucket / 64] |= 1ULL << (bucket % 64);
+}
+
+void TimerWheel::unlinkLocked(uint32_t index)
+{
+    Entry& entry = mEntries[index];
+    if (entry.prev != kNil) {
+        mEntries[entry.prev].next = entry.next;
+    } else {
+        mHeads[entry.bucket] = entry.next;
+        if (entry.next == kNil) {
+            mOccupied[entry.bucket / 64] &= ~(1ULL << (entry.bucket % 64));
+        }
+    }
+    if (entry.next != kNil) {
+        mEntries[entry.next].prev = entry.prev;
+    }
+}
+
+uint32_t TimerWheel::detachLocked(size_t bucket)
+{
+    const uint32_t head = mHeads[bucket];
+    mHeads[bucket] = kNil;
+    mOccupied[bucket / 64] &= ~(1ULL << (bucket % 64));
+    return head;
+}
+
+void TimerWheel::cascadeLocked(size_t bucket)
+{
+    for (uint32_t index = detachLocked(bucket); index != kNil; ) {
+        const uint32_t next = mEntries[index].next;
+        insertLocked(index);
+        index = next;
+    }
+}
+
+void TimerWheel::fireLocked(uint64_t tick, uint64_t target)
+{
+    for (uint32_t index = detachLocked(tick % kLevel0Size); index != kNil; ) {
+        Entry& entry = mEntries[index];
+        const uint32_t next = entry.next;
+
+        if (entry.due <= tick) {
+            mDue.push_back(entry.cookie);
+            entry.due += entry.interval;
+            if (entry.due <= target) {
+                // Skip periods missed while the loop was busy instead of bursting.
+                entry.due = (target / entry.interval + 1) * entry.interval;
+            }
+        }
+        insertLocked(index);
+        index = next;
+    }
+}
+
+void TimerWheel::advanceLocked(uint64_t target)
+{
+    if (mIndex.empty()) {
+        mCurrent = std::max(mCurrent, target);
+        return;
+    }
+
+    while (mCurrent < target) {
+        const uint64_t boundary = (mCurrent | (kLevel0Size - 1)) + 1;
+        const int distance = nextSetBit(mOccupied, kLevel0Size, (mCurrent + 1) % kLevel0Size);
+        const uint64_t next = (distance >= 0) ? mCurrent + 1 + distance : UINT64_MAX;
+
+        if (next < boundary && next <= target) {
+            mCurrent = next;
+            fireLocked(next, target);
+            continue;
+        }
+        if (target < boundary) {
+            mCurrent = target;
+            break;
+        }
+
+        // Bring down what is due in the next 256 ticks, the outer level first.
+        mCurrent = boundary;
+        if ((boundary >> kLevel1Shift) % kLevelSize == 0) {
+            cascadeLocked(kLevel2Base + (boundary >> kLevel2Shift) % kLevelSize);
+        }
+        cascadeLocked(kLevel1Base + (boundary >> kLevel1Shift) % kLevelSize);
+        fireLocked(boundary, target);
+    }
+}
+
+void TimerWheel::rearmLocked(void)
+{
+    if (mTimerFd == -1) {
+        return;
+    }
+
+    uint64_t wake = UINT64_MAX;
+    int distance = nextSetBit(mOccupied, kLevel0Size, (mCurrent + 1) % kLevel0Size);
+    if (distance >= 0) {
+        wake = mCurrent + 1 + distance;
+    }
+    // Outer levels wake the loop at the start of their next occupied bucket, to cascade it.
+    const uint64_t block = mCurrent >> kLevel1Shift;
+    distance = nextSetBit(&mOccupied[kLevel1Base / 64], kLevelSize, (block + 1) % kLevelSize);
+    if (distance >= 0) {
+        wake = std::min(wake, (block + 1 + distance) << kLevel1Shift);
+    }
+    const uint64_t superblock = mCurrent >> kLevel2Shift;
+    distance = nextSetBit(&mOccupied[kLevel2Base / 64], kLevelSize, (superblock + 1) % kLevelSize);
+    if (distance >= 0) {
+        wake = std::min(wake, (superblock + 1 + distance) << kLevel2Shift);
+    }
+
+    struct itimerspec spec = {};    // all zero disarms
+    mArmedTick = 0;
+    if (wake != UINT64_MAX) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeOf(wake).time_since_epoch());
+        spec.it_value.tv_sec = ns.count() / 1000000000;
+        spec.it_value.tv_nsec = ns.count() % 1000000000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+        mArmedTick = wake;
+    }
+
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        ALOGE("timerfd_settime failed (error %d)", errno);
+    }
+}
+
+void TimerWheel::onTimer(void)
+{
+    int64_t lateness = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        const Clock::time_point now = Clock::now();
+
+        mStats.wakeups++;
+        if (mArmedTick != 0 && now >= timeOf(mArmedTick)) {
+            lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - timeOf(mArmedTick)).count();
+            mStats.maxLatenessNs = std::max<uint64_t>(mStats.maxLatenessNs, lateness);
+        }
+
+        mDue.clear();
+        advanceLocked(tickOf(now));
+        rearmLocked();
+
+        if (!mDue.empty()) {
+            mStats.batches++;
+            mStats.fired += mDue.size();
+        }
+    }
+
+    if (lateness >= 0) {
+        LatencyStats::record(LatencyStage::TIMER_JITTER, 0, lateness);
+    }
+    if (!mDue.empty()) {
+        mAction(mDue);
+    }
+}
+
+TimerWheel::Stats TimerWheel::stats(void) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void TimerWheel::dump(int fd) const
+{
+    const Stats s = stats();
+    size_t events;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        events = mIndex.size();
+    }
+
+    dprintf(fd, "Timer wheel: %zu events, %" PRIu64 " wakeups, %" PRIu64 " batches, %" PRIu64
+            " fired (%.1f per batch), max lateness %.1f us\n",
+            events, s.wakeups, s.batches, s.fired,
+            (s.batches != 0) ? static_cast<double>(s.fired) / s.batches : 0.0,
+            s.maxLatenessNs / 1000.0);
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TimerWheel_H_
+#define _TimerWheel_H_
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "EventLoop.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * Recurrent events on a hierarchical timer wheel driven by one EventLoop
+ * timerfd; a drop-in replacement of PropertyTimer.
+ *
+ *  - Time is counted in 1 ms ticks. Level 0 has a bucket per tick for the
+ *    next 256 ms, levels 1 and 2 have 64 buckets of 256 ms and 16.4 s that
+ *    are cascaded down as time reaches them. Registering, unregistering
+ *    and firing an event are O(1), whatever the number of events.
+ *  - Deadlines are multiples of the interval counted from a common epoch,
+ *    so events whose intervals divide each other (10, 20, 50, 100 Hz...)
+ *    fall on the same ticks and the action gets them in one call.
+ *  - The timerfd is armed for the next occupied tick only, there is no
+ *    periodic wakeup while nothing is due.
+ *  - Lateness of every wakeup is recorded as LatencyStage::TIMER_JITTER.
+ */
+class TimerWheel {
+public:
+    using Action = std::function<void(const std::vector<int32_t>& cookies)>;
+
+    static constexpr std::chrono::nanoseconds kTick = std::chrono::milliseconds(1);
+
+    struct Stats {
+        uint64_t    wakeups;        // timerfd expirations
+        uint64_t    batches;        // action calls
+        uint64_t    fired;          // cookies passed to the action
+        uint64_t    maxLatenessNs;
+    };
+
+    TimerWheel(EventLoop& loop, const Action& action);
+    ~TimerWheel(void);
+
+    /* The interval is rounded to whole ticks, at least one. */
+    void registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie);
+    void unregisterRecurrentEvent(int32_t cookie);
+
+    Stats stats(void) const;
+    void dump(int fd) const;
+
+private:
+    using Clock = std::chrono::steady_clock;   // CLOCK_MONOTONIC, as the timerfd
+
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr size_t kLevel0Bits = 8;
+    static constexpr size_t kLevelBits = 6;
+    static constexpr size_t kLevel0Size = 1 << kLevel0Bits;
+    static constexpr size_t kLevelSize = 1 << kLevelBits;
+    static constexpr size_t kLevel1Shift = kLevel0Bits;
+    static constexpr size_t kLevel2Shift = kLevel0Bits + kLevelBits;
+    static constexpr uint64_t kHorizon = 1ULL << (kLevel2Shift + kLevelBits);   // in ticks
+    // Buckets of all levels in one array: level 0, then level 1, then level 2.
+    static constexpr size_t kLevel1Base = kLevel0Size;
+    static constexpr size_t kLevel2Base = kLevel0Size + kLevelSize;
+    static constexpr size_t kBuckets = kLevel0Size + 2 * kLevelSize;
+
+    struct Entry {
+        int32_t     cookie;
+        uint64_t    interval;   // ticks
+        uint64_t    due;        // tick
+        uint32_t    bucket;
+        uint32_t    prev;
+        uint32_t    next;
+    };
+
+    uint64_t tickOf(Clock::time_point time) const;
+    Clock::time_point timeOf(uint64_t tick) const;
+
+    void insertLocked(uint32_t index);
+    void unlinkLocked(uint32_t index);
+    uint32_t detachLocked(size_t bucket);
+    void cascadeLocked(size_t bucket);
+    void fireLocked(uint64_t tick, uint64_t target);
+    void advanceLocked(uint64_t target);
+    void rearmLocked(void);
+
+    void onTimer(void);
+
+    Action                              mAction;
+    int                                 mTimerFd;
+    const Clock::time_point             mEpoch;
+    mutable std::mutex                  mLock;
+    uint64_t                            mCurrent;       // last tick processed
+    uint64_t                            mArmedTick;     // 0 when disarmed
+    uint32_t                            mHeads[kBuckets];
+    uint64_t                            mOccupied[kBuckets / 64];
+    std::vector<Entry>                  mEntries;
+    std::vector<uint32_t>               mFree;          // unused mEntries
+    std::unordered_map<int32_t, uint32_t> mIndex;       // cookie -> mEntries index
+    std::vector<int32_t>                mDue;           // loop thread only
+    Stats                               mStats;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _TimerWheel_H_
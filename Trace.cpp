@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include "Trace.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static const char* traceEventName(TraceEvent event)
+{
+    switch (event) {
+        case TraceEvent::SET:           return "set";
+        case TraceEvent::PROP_EVENT:    return "event";
+        case TraceEvent::CAN_RX:        return "can-rx";
+        case TraceEvent::CAN_QUEUE:     return "can-queue";
+        case TraceEvent::CAN_TX:        return "can-tx";
+        case TraceEvent::ISOTP_RX:      return "isotp-rx";
+        case TraceEvent::ISOTP_TX:      return "isotp-tx";
+    }
+    return "?";
+}
+
+void TraceRing::dump(int fd) const
+{
+    const uint64_t next = mNext.load(std::memory_order_acquire);
+    const uint64_t first = (next > kTraceCapacity) ? next - kTraceCapacity : 0;
+
+    dprintf(fd, "Trace: %" PRIu64 " records, showing the last %" PRIu64 "\n", next, next - first);
+
+    for (uint64_t index = first; index < next; index++) {
+        const Slot& slot = mSlots[index & (kTraceCapacity - 1)];
+
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const TraceRecord record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence != index + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;   // Being written or already overwritten
+        }
+
+        dprintf(fd, "%" PRId64 " %-9s 0x%08x 0x%x %g %u\n", record.timestamp,
+                traceEventName(record.event), record.id, record.arg, record.value, record.count);
+    }
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _Trace_H_
+#define _Trace_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include <inttypes.h>
+
+#include <utils/SystemClock.h>
+
+/*
+ * Hot-path tracing: VHAL_TRACE(event, id, arg, value, count) stores a fixed
+ * size binary record and formats nothing. Builds without VHAL_TRACE_ENABLED
+ * (see Android.bp, only debuggable builds set it) compile it away entirely.
+ */
+#ifndef VHAL_TRACE_ENABLED
+#define VHAL_TRACE_ENABLED 0
+#endif
+
+#if VHAL_TRACE_ENABLED
+#define VHAL_TRACE(event, id, arg, value, count) \
+    ::android::hardware::automotive::vehicle::V2_0::renesas::TraceRing::instance().record( \
+            ::android::hardware::automotive::vehicle::V2_0::renesas::TraceEvent::event, \
+            (id), (arg), (value), (count))
+#else
+#define VHAL_TRACE(event, id, arg, value, count) ((void)0)
+#endif
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* What id and arg of a record hold depends on its event. */
+enum class TraceEvent : uint8_t {
+    SET = 1,        // prop, area, first element, number of elements
+    PROP_EVENT,     // prop, area, first element, 1 if sent to subscribers, 0 if suppressed
+    CAN_RX,         // CAN ID, bus frame length, -, -
+    CAN_QUEUE,      // CAN ID, area, frame length, -
+    CAN_TX,         // CAN ID, frame length, -, -
+    ISOTP_RX,       // prop, area, message length, -
+    ISOTP_TX,       // prop, area, message length, -
+};
+
+struct TraceRecord {
+    int64_t     timestamp;  // elapsedRealtimeNano()
+    double      value;
+    int32_t     id;
+    int32_t     arg;
+    uint16_t    count;
+    TraceEvent  event;
+};
+
+/**
+ * Process-wide ring of the latest kTraceCapacity records. Any thread may
+ * record without locking: writers claim slots with one atomic increment and
+ * a per-slot sequence number lets dump() skip records overwritten while it
+ * was reading them.
+ */
+class TraceRing {
+public:
+    static constexpr size_t kTraceCapacity = 4096;  // power of two
+
+    static TraceRing& instance(void)
+    {
+        static TraceRing ring;
+        return ring;
+    }
+
+    void record(TraceEvent event, int32_t id, int32_t arg, double value, uint16_t count)
+    {
+        const uint64_t index = mNext.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = mSlots[index & (kTraceCapacity - 1)];
+
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record.timestamp = elapsedRealtimeNano();
+        slot.record.value = value;
+        slot.record.id = id;
+        slot.record.arg = arg;
+        slot.record.count = count;
+        slot.record.event = event;
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    /* Writes the records, oldest first, as text to fd. */
+    void dump(int fd) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t>   sequence {0};   // index + 1 of the record, 0 while written
+        TraceRecord             record {};
+    };
+
+    TraceRing(void) : mNext(0) {}
+
+    alignas(64) std::atomic<uint64_t> mNext;
+    Slot                            mSlots[kTraceCapacity];
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _Trace_H_
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "VehicleHalImpl"
+
+#include <log/log.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+
+#include <net/if.h>
+
+#include "VehicleHalConfig.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+using android::base::GetBoolProperty;
+using android::base::GetProperty;
+using android::base::GetUintProperty;
+
+VehicleHalConfig VehicleHalConfig::fromSystemProperties(void)
+{
+    VehicleHalConfig config;
+
+    std::string interfaces = GetProperty("ro.vendor.vehicle.can.interfaces", "");
+    if (!interfaces.empty()) {
+        std::vector<std::string> names;
+        for (auto& name : android::base::Split(interfaces, ",")) {
+            name = android::base::Trim(name);
+            if (name.empty() || name.size() >= IFNAMSIZ) {
+                ALOGW("Ignoring CAN interface '%s'", name.c_str());
+                continue;
+            }
+            if (names.size() == kCanMaxInterfaces) {
+                ALOGW("Only %zu CAN interfaces are supported", kCanMaxInterfaces);
+                break;
+            }
+            names.push_back(name);
+        }
+        if (!names.empty()) {
+            config.canInterfaces = std::move(names);
+        }
+    }
+
+    config.canRxBatchSize = GetUintProperty<size_t>("ro.vendor.vehicle.can.rx_batch_size",
+                                                    config.canRxBatchSize, kCanRxMaxBatchSize);
+    if (config.canRxBatchSize == 0) {
+        config.canRxBatchSize = 1;
+    }
+
+    config.canRxBatchLatency = std::chrono::microseconds(
+        GetUintProperty<uint32_t>("ro.vendor.vehicle.can.rx_batch_latency_us",
+                                  config.canRxBatchLatency.count(), 100000));
+
+    config.canRxRingSize = GetUintProperty<size_t>("ro.vendor.vehicle.can.rx_ring_size",
+                                                   config.canRxRingSize, kCanRxMaxRingSize);
+    if (config.canRxRingSize < config.canRxBatchSize) {
+        config.canRxRingSize = config.canRxBatchSize;
+    }
+
+    config.canRxFilter = GetBoolProperty("ro.vendor.vehicle.can.rx_filter", config.canRxFilter);
+    config.canRxSuppressUnchanged = GetBoolProperty("ro.vendor.vehicle.can.rx_suppress_unchanged",
+                                                    config.canRxSuppressUnchanged);
+    config.canRxHwTimestamps = GetBoolProperty("ro.vendor.vehicle.can.rx_hw_timestamps",
+                                               config.canRxHwTimestamps);
+    config.canFd = GetBoolProperty("ro.vendor.vehicle.can.fd", config.canFd);
+    config.canBitrate = GetUintProperty<uint32_t>("ro.vendor.vehicle.can.bitrate",
+                                                  config.canBitrate, 8000000);
+    config.canTxBusShare = GetUintProperty<uint32_t>("ro.vendor.vehicle.can.tx_bus_share",
+                                                     config.canTxBusShare, 100);
+
+    ALOGI("CAN interfaces: %s", android::base::Join(config.canInterfaces, ',').c_str());
+    ALOGI("CAN TX budget: %u%% of %u bit/s", config.canTxBusShare, config.canBitrate);
+    ALOGI("CAN RX batch: %zu frames, %lld us, ring %zu frames", config.canRxBatchSize,
+          static_cast<long long>(config.canRxBatchLatency.count()), config.canRxRingSize);
+
+    return config;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _VehicleHalConfig_H_
+#define _VehicleHalConfig_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* Transmission class of the CAN frames carrying a property, highest first. */
+enum class CanTxPriority : uint8_t {
+    HIGH = 0,       // driving and safety related requests
+    NORMAL = 1,
+    LOW = 2,        // comfort and cosmetic settings
+};
+
+constexpr size_t kCanTxPriorities = 3;
+
+struct CanTxPolicy {
+    CanTxPriority               priority = CanTxPriority::NORMAL;
+    /* Minimum time between two frames of one (property, area). */
+    std::chrono::milliseconds   minInterval {0};
+};
+
+/**
+ * Run-time tunables of the Vehicle HAL. Defaults are used unless
+ * overridden by the ro.vendor.vehicle.* system properties.
+ */
+struct VehicleHalConfig {
+    static constexpr size_t kCanRxMaxBatchSize = 256;
+    static constexpr size_t kCanMaxInterfaces = 8;
+    static constexpr size_t kCanRxMaxRingSize = 65536;
+
+    /* SocketCAN interfaces, in the bus order DefaultCanConfig.h routes to. */
+    std::vector<std::string>    canInterfaces {"can0"};
+
+    /* Max number of CAN frames drained by one recvmmsg() wakeup. 1 disables batching. */
+    size_t                      canRxBatchSize = 32;
+    /* How long to wait for a batch to fill up once the first frame arrived. */
+    std::chrono::microseconds   canRxBatchLatency {0};
+    /* Received frames queued between socket draining and property dispatch. */
+    size_t                      canRxRingSize = 1024;
+    /*
+     * Install CAN_RAW_FILTER so only frames of known properties reach the HAL.
+     * Without it, classic frames of unknown CAN IDs are decoded as the
+     * baseline {propId, propValue} messages.
+     */
+    bool                        canRxFilter = true;
+    /* Drop RX events of ON_CHANGE properties whose value did not change. */
+    bool                        canRxSuppressUnchanged = true;
+    /* Stamp RX events with the controller clock instead of the kernel software stamp.
+     * Only valid when the controller clock is synchronized to CLOCK_REALTIME. */
+    bool                        canRxHwTimestamps = false;
+    /* Use CAN FD frames when the interface supports them. */
+    bool                        canFd = true;
+    /* Nominal bit rate of the buses, used to budget transmissions. */
+    uint32_t                    canBitrate = 500000;
+    /* Max share of the bus bandwidth, in percent, the HAL may transmit. 0 disables the limit. */
+    uint32_t                    canTxBusShare = 30;
+
+    static VehicleHalConfig fromSystemProperties(void);
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _VehicleHalConfig_H_
@@ -20,8 +20,17 @@
 #include <log/log.h>
 #include <android-base/macros.h>
 
+#include <algorithm>
+
+#include <stdio.h>
+#include <sys/eventfd.h>
+
 #include "VehicleHalImpl.h"
 #include "DefaultConfig.h"
+#include "DefaultCanConfig.h"
+#include "CanProtocol.h"
+#include "LatencyStats.h"
+#include "Trace.h"
 
 namespace android {
 namespace hardware {
@@ -33,52 +42,258 @@ namespace renesas {
 #define SIZEOF_BIT_ARRAY(bits)  ((bits + 7) / 8)
 #define TEST_BIT(bit, array)    (array[bit / 8] & (1 << (bit % 8)))
 
-typedef struct __attribute__((packed, aligned(2))) vhal_can_msg_s {
-    int32_t     propId;
-    int32_t     propValue;
-} vhal_can_msg_t;
+static float getPhysicalValue(const VehiclePropValue& propValue)
+{
+    if (getPropType(propValue.prop) == VehiclePropertyType::FLOAT) {
+        return (propValue.value.floatValues.size() != 0) ? propValue.value.floatValues[0] : 0.0f;
+    }
+    return (propValue.value.int32Values.size() != 0) ? propValue.value.int32Values[0] : 0;
+}
+
+static void setPhysicalValue(VehiclePropValue* propValue, float value)
+{
+    if (getPropType(propValue->prop) == VehiclePropertyType::FLOAT) {
+        propValue->value.floatValues.resize(1);
+        propValue->value.floatValues[0] = value;
+    } else {
+        propValue->value.int32Values.resize(1);
+        propValue->value.int32Values[0] = static_cast<int32_t>(std::lround(value));
+    }
+}
+
+static constexpr size_t kIsoTpTxMaxQueued = 16;
+
+/* Fits into a classic CAN VHAL message. */
+static bool isScalarValue(const VehiclePropValue::RawValue& value)
+{
+    return value.int32Values.size() + value.floatValues.size() <= 1
+            && value.int64Values.size() == 0 && value.bytes.size() == 0
+            && value.stringValue.size() == 0;
+}
+
+/* A CAN FD VHAL message carries one value array. */
+static bool isSingleArrayValue(const VehiclePropValue::RawValue& value)
+{
+    return (value.int32Values.size() != 0) + (value.floatValues.size() != 0)
+            + (value.int64Values.size() != 0) + (value.bytes.size() != 0)
+            + (value.stringValue.size() != 0) <= 1;
+}
 
-VehicleHalImpl::VehicleHalImpl(VehiclePropertyStore* propStore) :
+static bool isPhysicalValueChanged(const VehiclePropValue& propValue, float value, float deadband)
+{
+    if (getPropType(propValue.prop) == VehiclePropertyType::FLOAT) {
+        return (propValue.value.floatValues.size() == 0)
+                || std::fabs(propValue.value.floatValues[0] - value) > deadband;
+    }
+    return (propValue.value.int32Values.size() == 0)
+            || propValue.value.int32Values[0] != static_cast<int32_t>(std::lround(value));
+}
+
+static bool isRawValueChanged(const VehiclePropValue::RawValue& previous,
+                              const VehiclePropValue::RawValue& current, float deadband)
+{
+    if (previous.int32Values != current.int32Values
+            || previous.int64Values != current.int64Values
+            || previous.bytes != current.bytes
+            || previous.stringValue != current.stringValue
+            || previous.floatValues.size() != current.floatValues.size()) {
+        return true;
+    }
+    for (size_t i = 0; i < current.floatValues.size(); i++) {
+        if (std::fabs(previous.floatValues[i] - current.floatValues[i]) > deadband) {
+            return true;
+        }
+    }
+    return false;
+}
+
+VehicleHalImpl::VehicleHalImpl(StaticPropertyStore* propStore, const VehicleHalConfig& config) :
+    mConfig(config),
     mPropStore(propStore),
-    mHvacPowerProps(std::begin(kHvacPowerProperties), std::end(kHvacPowerProperties)),
-    mRecurrentTimer(std::bind(&VehicleHalImpl::onContinuousPropertyTimer,
-                                  this, std::placeholders::_1)),
-    mSocket(socket(PF_CAN, SOCK_RAW, CAN_RAW)),
-    mCanThreadExit(false),
-    mGpioThreadExit(false)
+    mMetadata(*propStore),
+    mGating(*propStore, std::vector<PropertyGateDeclaration>(std::begin(kPropertyGates),
+                                                             std::end(kPropertyGates))),
+    mPropertyTimer(mEventLoop, std::bind(&VehicleHalImpl::onContinuousPropertyTimer,
+                                         this, std::placeholders::_1)),
+    mCanRxRing(config.canRxRingSize),
+    mCanRxQueued(0),
+    mCanDispatchFd(eventfd(0, EFD_CLOEXEC)),
+    mCanDispatchExit(false),
+    mIsoTpBus(nullptr),
+    // Block size 0 and STmin 0: the dispatch thread takes whole messages at bus speed.
+    mIsoTpReceiver(kVhalIsoTpMaxMessageSize, 0, 0, [this](const uint8_t* data, size_t length) {
+        return mIsoTpBus->send(kCanIsoTpTxId, data, length);
+    }),
+    mIsoTpSender(kVhalIsoTpMaxMessageSize, [this](const uint8_t* data, size_t length) {
+        return mIsoTpBus->send(kCanIsoTpTxId, data, length);
+    }),
+    mIsoTpTxEvent(-1),
+    mIsoTpTxTimer(-1),
+    mGpioFd(-1),
+    mGpioRetryTimer(-1),
+    mGpioRetries(0)
 {
+    // The store was built from kVehicleProperties, nothing to register.
     for (size_t i = 0; i < arraysize(kVehicleProperties); i++) {
-        mPropStore->registerProperty(kVehicleProperties[i].config);
+        mCanTxPolicies.emplace(kVehicleProperties[i].config.prop, kVehicleProperties[i].txPolicy);
     }
 
-    if (mSocket < 0) {
-        ALOGE("CAN RAW socket is NOT created. Vehicle HAL will be offline.");
-    }
+    buildCanRxIndex();
 
-    std::memset(&mSockAddr, 0, sizeof(mSockAddr));
+    for (auto& name : mConfig.canInterfaces) {
+        mCanBuses.push_back(std::make_unique<CanBus>(name, mConfig));
+    }
+    buildCanRoutes();
 }
 
 VehicleHalImpl::~VehicleHalImpl(void)
 {
     ALOGD("%s: ->", __func__);
 
-    mCanThreadExit = true;  // Notify thread to finish and wait for it to terminate.
-    mGpioThreadExit = true; //
+    mEventLoop.stop();  // Wakes the loop up and waits for it to terminate.
 
-    if (mCanThread.joinable()) {
-        mCanThread.join();
+    if (mCanDispatchThread.joinable()) {
+        mCanDispatchExit = true;
+        wakeCanDispatch();
+        mCanDispatchThread.join();
     }
-    if (mGpioThread.joinable()) {
-        mGpioThread.join();
+    if (mCanDispatchFd != -1) {
+        close(mCanDispatchFd);
     }
 
-    if (mSocket != -1) {
-        close(mSocket);
+    ALOGI("ISO-TP: received %" PRIu64 " (aborted %" PRIu64 "), sent %" PRIu64 " (aborted %" PRIu64 ")",
+          uint64_t(mIsoTpReceiver.stats().completed), uint64_t(mIsoTpReceiver.stats().aborted),
+          uint64_t(mIsoTpSender.stats().completed), uint64_t(mIsoTpSender.stats().aborted));
+    if (mIsoTpTxEvent != -1) {
+        close(mIsoTpTxEvent);
+    }
+    if (mIsoTpTxTimer != -1) {
+        close(mIsoTpTxTimer);
+    }
+
+    mCanBuses.clear();  // Closes the sockets and logs the final counters.
+
+    if (mGpioFd != -1) {
+        close(mGpioFd);
+    }
+    if (mGpioRetryTimer != -1) {
+        close(mGpioRetryTimer);
     }
 
     ALOGD("%s: <-", __func__);
 }
 
+void VehicleHalImpl::buildCanRxIndex(void)
+{
+    for (auto& it : kVehicleProperties) {
+        const VehiclePropConfig& cfg = it.config;
+        int32_t areaId = 0;
+        std::vector<int32_t> areaIds;
+
+        if (!isGlobalProp(cfg.prop)) {
+            if (cfg.areaConfigs.size() == 0) {
+                continue;   // No values are stored for such property
+            }
+
+            // Messages with area index 0 update the lowest area,
+            // like the whole store scan used to do.
+            areaId = cfg.areaConfigs[0].areaId;
+            for (auto& areaConfig : cfg.areaConfigs) {
+                areaId = std::min(areaId, areaConfig.areaId);
+                areaIds.push_back(areaConfig.areaId);
+            }
+            if (areaIds.size() > kCanVhalMaxAreaIndex) {
+                ALOGW("Prop 0x%x: only %zu of %zu areas are addressable over classic CAN",
+                      cfg.prop, kCanVhalMaxAreaIndex, areaIds.size());
+            }
+        }
+
+        float deadband = 0.0f;
+        for (auto& entry : kCanDeadbands) {
+            if (entry.prop == cfg.prop) {
+                deadband = entry.deadband;
+            }
+        }
+
+        // The first declaration wins, the same way registerProperty() does.
+        mCanRxIndex.emplace(cfg.prop, CanRxProperty {
+            .areaId = areaId,
+            .onChange = mConfig.canRxSuppressUnchanged
+                    && cfg.changeMode == VehiclePropertyChangeMode::ON_CHANGE,
+            .deadband = deadband,
+            .areaIds = std::move(areaIds)
+        });
+    }
+
+    ALOGI("CAN RX index: %zu properties", mCanRxIndex.size());
+}
+
+void VehicleHalImpl::buildCanRoutes(void)
+{
+    auto busAt = [this](uint8_t bus) {
+        return mCanBuses[(bus < mCanBuses.size()) ? bus : 0].get();
+    };
+
+    for (auto& message : kCanMessages) {
+        CanBus* bus = busAt(kCanBusPowertrain);
+        for (auto& route : kCanMessageRoutes) {
+            if (route.canId == message.canId) {
+                bus = busAt(route.bus);
+            }
+        }
+        mCanRoutes[message.canId] = bus;
+    }
+
+    for (auto& it : mCanRxIndex) {
+        CanBus* bus = busAt(kCanDefaultPropertyBus);
+        for (auto& route : kCanPropertyRoutes) {
+            if (route.prop == it.first) {
+                bus = busAt(route.bus);
+            }
+        }
+        mCanRoutes[canIdForProperty(it.first)] = bus;
+    }
+
+    mIsoTpBus = busAt(kCanIsoTpBus);
+    mCanRoutes[kCanIsoTpRxId] = mIsoTpBus;
+
+    for (auto& bus : mCanBuses) {
+        const CanBus* busPtr = bus.get();
+        ALOGI("CAN routes: %s carries %zu CAN IDs", bus->name().c_str(),
+              size_t(std::count_if(mCanRoutes.begin(), mCanRoutes.end(),
+                                   [busPtr](auto& route) { return route.second == busPtr; })));
+    }
+}
+
+CanBus* VehicleHalImpl::canBusFor(canid_t canId) const
+{
+    // All areas of a property share the route of area index 0.
+    auto it = mCanRoutes.find(isVhalCanId(canId) ? (canId & ~kCanVhalAreaMask) : canId);
+    return (it != mCanRoutes.end()) ? it->second : mCanBuses[0].get();
+}
+
+std::vector<struct can_filter> VehicleHalImpl::canRxFilters(const CanBus* bus) const
+{
+    std::vector<struct can_filter> filters;
+
+    for (auto& route : mCanRoutes) {
+        if (route.second != bus) {
+            continue;
+        }
+
+        const bool extended = (route.first & CAN_EFF_FLAG) != 0;
+        canid_t mask = CAN_EFF_FLAG | CAN_RTR_FLAG | (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+        if (isVhalCanId(route.first)) {
+            mask &= ~kCanVhalAreaMask;  // any area of the property
+        }
+        filters.push_back({
+            .can_id = route.first,
+            .can_mask = mask
+        });
+    }
+    return filters;
+}
+
 void VehicleHalImpl::onCreate(void)
 {
     for (auto& it : kVehicleProperties) {
@@ -126,30 +341,39 @@ void VehicleHalImpl::onCreate(void)
 
         }
     }
+    mGating.refresh();
 
-    if (mSocket != -1) {
-        struct ifreq ifr;
-        std::memset(&ifr.ifr_name, 0, sizeof(ifr.ifr_name));
-        std::strcpy(ifr.ifr_name, "can0");
-
-        if (ioctl(mSocket, SIOCGIFINDEX, &ifr) < 0) {
-            ALOGE("ioctl SIOCGIFINDEX failed (error %d)", errno);
-        } else {
-            mSockAddr.can_family = AF_CAN;
-            mSockAddr.can_ifindex = ifr.ifr_ifindex;
+    mCanRxEvents.reserve(mConfig.canRxBatchSize);
 
-            if (bind(mSocket, (struct sockaddr*)&mSockAddr, sizeof(mSockAddr)) < 0) {
-                ALOGE("bind CAN socket failed (error %d)", errno);
-                close(mSocket);
-                mSocket = -1;
-            } else {
-                ALOGI("CAN RAW: IFACE=%s, IFINDEX=%d, SOCKET=%d\n", ifr.ifr_name, ifr.ifr_ifindex, mSocket);
-            }
+    size_t online = 0;
+    for (auto& bus : mCanBuses) {
+        if (!bus->open(canRxFilters(bus.get()))) {
+            continue;
         }
+
+        bus->attach(mEventLoop,
+                    std::bind(&VehicleHalImpl::queueCanFrame, this, std::placeholders::_1,
+                              std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+                    std::bind(&VehicleHalImpl::wakeCanDispatch, this));
+        online++;
+    }
+    if (online == 0) {
+        ALOGE("No CAN interface is available. Vehicle HAL will be offline.");
+    } else if (mCanDispatchFd < 0) {
+        ALOGE("eventfd failed (error %d), CAN RX is disabled", errno);
+    } else {
+        mCanDispatchThread = std::thread(&VehicleHalImpl::CanDispatchThread, this);
+    }
+
+    if (mIsoTpBus->isOpen()) {
+        mIsoTpTxEvent = mEventLoop.addEvent(std::bind(&VehicleHalImpl::pumpIsoTpTx, this));
+        mIsoTpTxTimer = mEventLoop.addTimer(std::bind(&VehicleHalImpl::pumpIsoTpTx, this));
     }
 
-    mCanThread = std::thread(&VehicleHalImpl::CanRxHandleThread, this);
-    mGpioThread = std::thread(&VehicleHalImpl::GpioHandleThread, this);
+    mGpioRetryTimer = mEventLoop.addTimer(std::bind(&VehicleHalImpl::openGpioDevice, this));
+    openGpioDevice();
+
+    mEventLoop.start();
 }
 
 std::vector<VehiclePropConfig> VehicleHalImpl::listProperties(void)
@@ -162,9 +386,15 @@ VehicleHal::VehiclePropValuePtr VehicleHalImpl::get(const VehiclePropValue& requ
 {
     VehiclePropValuePtr propValuePtr = nullptr;
 
-    auto internalPropValue = mPropStore->readValueOrNull(requestedPropValue);
-    if (internalPropValue != nullptr) {
-        propValuePtr = getValuePool()->obtain(*internalPropValue);
+    const size_t slot = mPropStore->slotOf(requestedPropValue.prop, requestedPropValue.areaId);
+    if (slot != StaticPropertyStore::kNoSlot) {
+        auto internalPropValue = mPropStore->readSlotOrNull(slot);
+        if (internalPropValue != nullptr) {
+            propValuePtr = getValuePool()->obtain(*internalPropValue);
+            if (!mGating.isAvailable(slot)) {
+                propValuePtr->status = VehiclePropertyStatus::UNAVAILABLE;
+            }
+        }
     }
 
     ALOGV("..get 0x%08x", requestedPropValue.prop);
@@ -175,53 +405,74 @@ VehicleHal::VehiclePropValuePtr VehicleHalImpl::get(const VehiclePropValue& requ
 
 StatusCode VehicleHalImpl::set(const VehiclePropValue& propValue)
 {
-     if (mHvacPowerProps.count(propValue.prop)) {
-        auto hvacPowerOn = mPropStore->readValueOrNull(toInt(VehicleProperty::HVAC_POWER_ON),
-                                                      toInt(VehicleAreaSeat::ROW_1_CENTER));
+    LatencyScope latency(LatencyStage::SET, propValue.prop);
 
-        if (hvacPowerOn && hvacPowerOn->value.int32Values.size() == 1
-                && hvacPowerOn->value.int32Values[0] == 0) {
-            return StatusCode::NOT_AVAILABLE;
-        }
+    const size_t slot = mPropStore->slotOf(propValue.prop, propValue.areaId);
+    if (slot == StaticPropertyStore::kNoSlot) {
+        return StatusCode::INVALID_ARG;
+    }
+    if (!mGating.isAvailable(slot)) {
+        return StatusCode::NOT_AVAILABLE;
     }
 
     if (!mPropStore->writeValue(propValue, true)) {
         return StatusCode::INVALID_ARG;
     }
 
-    vhal_can_msg_t msg = {propValue.prop, 0};
+    if (mGating.controls(slot)) {
+        std::vector<VehiclePropValuePtr> events;
+        queueAvailabilityChanges(slot, events);
+        for (auto& event : events) {
+            doHalEvent(std::move(event));
+        }
+    }
+
+    const PropertyMetadata* metadata = &mMetadata.at(slot);
 
-    if (propValue.value.int32Values.size() != 0) {
-        msg.propValue = static_cast<int32_t>(propValue.value.int32Values[0]);
-    } else if (propValue.value.floatValues.size() != 0) {
-        msg.propValue = (int32_t)propValue.value.floatValues[0];
-    } else if (propValue.value.int64Values.size() != 0) {
-        ALOGW("TODO: INT64 values send is unsupported by now");
-    } else if(propValue.value.bytes.size() != 0) {
-        ALOGW("TODO: BYTE-array send is unsupported by now");
+    canid_t canId = canIdForProperty(propValue.prop);
+    size_t areaIndex = 0;
+    auto indexIt = mCanRxIndex.find(propValue.prop);
+    if (indexIt != mCanRxIndex.end() && propValue.areaId != indexIt->second.areaId) {
+        const auto& areaIds = indexIt->second.areaIds;
+        areaIndex = std::find(areaIds.begin(), areaIds.end(), propValue.areaId) - areaIds.begin() + 1;
     }
 
-    VehicleHalImpl::CanTxBytes(&msg, sizeof(msg));
+    static const CanTxPolicy kDefaultPolicy;
+    auto policyIt = mCanTxPolicies.find(propValue.prop);
+    const CanTxPolicy& policy = (policyIt != mCanTxPolicies.end()) ? policyIt->second : kDefaultPolicy;
 
-    ALOGD("..set 0x%08x areaId=0x%x int32Values=%zu floatValues=%zu int64Values=%zu bytes=%zu string='%s'",
-        propValue.prop,
-        propValue.areaId,
-        propValue.value.int32Values.size(),
-        propValue.value.floatValues.size(),
-        propValue.value.int64Values.size(),
-        propValue.value.bytes.size(),
-        propValue.value.stringValue.c_str());
+    if (metadata->canMessage != PropertyMetadata::kNone) {
+        sendCanSignals(propValue, kCanMessages[metadata->canMessage], policy);
+    } else if (canBusFor(canId)->isFd() && isSingleArrayValue(propValue.value)) {
+        vhal_canfd_msg_t msg;
+        size_t length = encodeCanFdMessage(propValue, &msg);
 
-    for(size_t i = 0; i < propValue.value.int32Values.size(); i++) {
-        ALOGD("int32Values[%zu]=%d", i, propValue.value.int32Values[i]);
-    }
-    for(size_t i = 0; i < propValue.value.floatValues.size(); i++) {
-        ALOGD("floatValues[%zu]=%f", i, propValue.value.floatValues[i]);
-    }
-    for(size_t i = 0; i < propValue.value.int64Values.size(); i++) {
-        ALOGD("int64Values[%zu]=%" PRId64 " ", i, propValue.value.int64Values[i]);
+        if (length != 0) {
+            VehicleHalImpl::CanTxBytes(canId, &msg, length, propValue.areaId, policy);
+        } else {
+            sendIsoTpMessage(propValue);
+        }
+    } else if (!canBusFor(canId)->isFd() && isScalarValue(propValue.value)
+            && areaIndex <= kCanVhalMaxAreaIndex) {
+        vhal_can_msg_t msg = {propValue.prop, 0};
+
+        if (propValue.value.int32Values.size() != 0) {
+            msg.propValue = static_cast<int32_t>(propValue.value.int32Values[0]);
+        } else if (propValue.value.floatValues.size() != 0) {
+            msg.propValue = (int32_t)propValue.value.floatValues[0];
+        }
+
+        VehicleHalImpl::CanTxBytes(canIdForProperty(propValue.prop, areaIndex), &msg, sizeof(msg),
+                                   propValue.areaId, policy);
+    } else {
+        sendIsoTpMessage(propValue);
     }
 
+    VHAL_TRACE(SET, propValue.prop, propValue.areaId, getPhysicalValue(propValue),
+               propValue.value.int32Values.size() + propValue.value.floatValues.size()
+               + propValue.value.int64Values.size() + propValue.value.bytes.size()
+               + propValue.value.stringValue.size());
+
     return StatusCode::OK;
 }
 
@@ -229,8 +480,8 @@ StatusCode VehicleHalImpl::subscribe(int32_t property, float sampleRate)
 {
     ALOGI("%s propId: 0x%x, sampleRate: %f", __func__, property, sampleRate);
 
-    if (isContinuousProperty(property)) {
-        mRecurrentTimer.registerRecurrentEvent(hertzToNanoseconds(sampleRate), property);
+    if (continuousProperty(property) != nullptr) {
+        mPropertyTimer.registerRecurrentEvent(hertzToNanoseconds(sampleRate), property);
     }
     return StatusCode::OK;
 }
@@ -238,30 +489,32 @@ StatusCode VehicleHalImpl::subscribe(int32_t property, float sampleRate)
 StatusCode VehicleHalImpl::unsubscribe(int32_t property)
 {
     ALOGI("%s propId: 0x%x", __func__, property);
-    if (isContinuousProperty(property)) {
-        mRecurrentTimer.unregisterRecurrentEvent(property);
+    if (continuousProperty(property) != nullptr) {
+        mPropertyTimer.unregisterRecurrentEvent(property);
     }
     return StatusCode::OK;
 }
 
 void VehicleHalImpl::onContinuousPropertyTimer(const std::vector<int32_t>& properties)
 {
-    VehiclePropValuePtr propValuePtr;
     auto& pool = *getValuePool();
+    const auto tick = std::chrono::steady_clock::now();
 
     for (int32_t property : properties) {
-        if (isContinuousProperty(property)) {
-            auto internalPropValue = mPropStore->readValueOrNull(property);
-            if (internalPropValue != nullptr) {
-                propValuePtr = pool.obtain(*internalPropValue);
-            }
-        } else {
+        const PropertyMetadata* metadata = continuousProperty(property);
+        if (metadata == nullptr) {
             ALOGE("Unexpected onContinuousPropertyTimer for property: 0x%x", property);
+            continue;
         }
 
-        if (propValuePtr.get()) {
-            propValuePtr->timestamp = elapsedRealtimeNano();
-            doHalEvent(std::move(propValuePtr));
+        for (size_t slot = metadata->firstSlot; slot < metadata->firstSlot + metadata->areaCount; slot++) {
+            auto internalPropValue = mPropStore->readSlotOrNull(slot);
+            if (internalPropValue != nullptr) {
+                VehiclePropValuePtr propValuePtr = pool.obtain(*internalPropValue);
+                propValuePtr->timestamp = elapsedRealtimeNano();
+                doHalEvent(std::move(propValuePtr));
+                LatencyStats::record(LatencyStage::TIMER, property, tick);
+            }
         }
     }
 }
@@ -296,176 +549,522 @@ void VehicleHalImpl::onGpioStateChanged(int fd, unsigned char* const key_bitmask
     }
 }
 
-bool VehicleHalImpl::isContinuousProperty(int32_t propId) const
+const PropertyMetadata* VehicleHalImpl::continuousProperty(int32_t propId) const
 {
-    const VehiclePropConfig* config = mPropStore->getConfigOrNull(propId);
-    if (config == nullptr) {
+    const PropertyMetadata* metadata = mMetadata.find(propId);
+    if (metadata == nullptr) {
         ALOGW("Config not found for property: 0x%x", propId);
+        return nullptr;
+    }
+    return (metadata->changeMode == VehiclePropertyChangeMode::CONTINUOUS) ? metadata : nullptr;
+}
+
+bool VehicleHalImpl::handleCanFrame(CanBus& bus, const struct canfd_frame& frame, size_t mtu,
+                                    int64_t timestamp, std::vector<VehiclePropValuePtr>& events)
+{
+    VHAL_TRACE(CAN_RX, frame.can_id, frame.len, 0, 0);
+
+    if (frame.can_id == kCanIsoTpRxId) {
+        return handleIsoTpFrame(bus, frame, timestamp, events);
+    }
+    const bool vhalCanId = isVhalCanId(frame.can_id);
+    if (!vhalCanId) {
+        const CanMessage* message = findCanMessage(kCanMessages,
+                                                   frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK));
+        if (message != nullptr) {
+            return handleCanSignalFrame(bus, *message, frame, timestamp, events);
+        }
+        // Without the RX filter the socket accepts everything, as it did
+        // before: then frames of other IDs are baseline {propId, propValue} ones.
+        if (mConfig.canRxFilter || mtu != CAN_MTU) {
+            return false;
+        }
+    }
+
+    std::unique_ptr<VehiclePropValue> internalPropValue;
+    const CanRxProperty* rxProperty = nullptr;
+    bool changed = true;
+
+    if (mtu == CANFD_MTU) {
+        const vhal_canfd_msg_t* pmsg = reinterpret_cast<const vhal_canfd_msg_t*>(&frame.data);
+
+        if (isCanFdAreaMessage(*pmsg)) {
+            return handleCanFdAreaFrame(bus, *pmsg, frame.len, timestamp, events);
+        }
+
+        auto indexIt = mCanRxIndex.find(pmsg->propId);
+        if (indexIt == mCanRxIndex.end()) {
+            return false;
+        }
+        rxProperty = &indexIt->second;
+
+        internalPropValue = mPropStore->readValueOrNull(pmsg->propId, pmsg->areaId);
+        if (internalPropValue == nullptr) {
+            return true;
+        }
+
+        VehiclePropValue::RawValue previous;
+        if (rxProperty->onChange) {
+            previous = internalPropValue->value;
+        }
+
+        if (!decodeCanFdMessage(*pmsg, frame.len, internalPropValue.get())) {
+            ALOGW("Malformed CAN FD message for prop 0x%x", pmsg->propId);
+            return true;
+        }
+
+        if (rxProperty->onChange) {
+            changed = isRawValueChanged(previous, internalPropValue->value, rxProperty->deadband);
+        }
+    } else {
+        // Like signal frames: a short frame would decode the bytes past its DLC.
+        if (frame.len < sizeof(vhal_can_msg_t)) {
+            return false;
+        }
+        const vhal_can_msg_t* pmsg = reinterpret_cast<const vhal_can_msg_t*>(&frame.data);
+
+        auto indexIt = mCanRxIndex.find(pmsg->propId);
+        if (indexIt == mCanRxIndex.end()) {
+            return false;
+        }
+        rxProperty = &indexIt->second;
+
+        const size_t areaIndex = vhalCanId ? canIdAreaIndex(frame.can_id) : 0;
+        int32_t areaId = rxProperty->areaId;
+        if (areaIndex != 0) {
+            if (areaIndex > rxProperty->areaIds.size()) {
+                ALOGW("Prop 0x%x has no area index %zu", pmsg->propId, areaIndex);
+                return true;
+            }
+            areaId = rxProperty->areaIds[areaIndex - 1];
+        }
+
+        internalPropValue = mPropStore->readValueOrNull(indexIt->first, areaId);
+        if (internalPropValue == nullptr) {
+            return true;
+        }
+
+        VehiclePropValue& propValue = *internalPropValue;
+        if (propValue.value.int32Values.size() != 0) {
+            changed = propValue.value.int32Values[0] != pmsg->propValue;
+            propValue.value.int32Values[0] = static_cast<int32_t>(pmsg->propValue);
+        } else if (propValue.value.floatValues.size() != 0){
+            changed = std::fabs(propValue.value.floatValues[0] - pmsg->propValue) > rxProperty->deadband;
+            propValue.value.floatValues[0] = (float)pmsg->propValue;
+        } else if (propValue.value.int64Values.size() != 0 || propValue.value.bytes.size() != 0) {
+            return false;   // INT64 and BYTES values are received over CAN FD only
+        }
+    }
+
+    internalPropValue->timestamp = timestamp;
+    commitCanValue(bus, *rxProperty, *internalPropValue, changed, events);
+    return true;
+}
+
+bool VehicleHalImpl::handleCanFdAreaFrame(CanBus& bus, const vhal_canfd_msg_t& msg, size_t length,
+                                          int64_t timestamp, std::vector<VehiclePropValuePtr>& events)
+{
+    vhal_canfd_area_value_t values[kVhalCanFdMaxAreas];
+    const size_t count = decodeCanFdAreas(msg, length, values);
+
+    auto indexIt = mCanRxIndex.find(msg.propId);
+    if (indexIt == mCanRxIndex.end()) {
         return false;
     }
-    return config->changeMode == VehiclePropertyChangeMode::CONTINUOUS;
+    if (count == 0) {
+        ALOGW("Malformed CAN FD area message for prop 0x%x", msg.propId);
+        return true;
+    }
+    const CanRxProperty& rxProperty = indexIt->second;
+    const bool isFloat = msg.valueType == static_cast<uint8_t>(VhalCanValueType::AREA_FLOAT);
+
+    // Every area becomes an event of its own, all of them queued with this frame's batch.
+    for (size_t i = 0; i < count; i++) {
+        auto internalPropValue = mPropStore->readValueOrNull(msg.propId, values[i].areaId);
+        if (internalPropValue == nullptr) {
+            continue;
+        }
+
+        const float value = isFloat ? values[i].floatValue : static_cast<float>(values[i].int32Value);
+        bool changed = true;
+        if (isFloat && internalPropValue->value.floatValues.size() != 0) {
+            changed = std::fabs(internalPropValue->value.floatValues[0] - value) > rxProperty.deadband;
+            internalPropValue->value.floatValues[0] = value;
+        } else if (!isFloat && internalPropValue->value.int32Values.size() != 0) {
+            changed = internalPropValue->value.int32Values[0] != values[i].int32Value;
+            internalPropValue->value.int32Values[0] = values[i].int32Value;
+        } else {
+            changed = isPhysicalValueChanged(*internalPropValue, value, rxProperty.deadband);
+            setPhysicalValue(internalPropValue.get(), value);
+        }
+
+        internalPropValue->timestamp = timestamp;
+        commitCanValue(bus, rxProperty, *internalPropValue, changed, events);
+    }
+    return true;
 }
 
-void VehicleHalImpl::CanRxHandleThread(void)
+bool VehicleHalImpl::handleCanSignalFrame(CanBus& bus, const CanMessage& message,
+                                          const struct canfd_frame& frame, int64_t timestamp,
+                                          std::vector<VehiclePropValuePtr>& events)
 {
-    if (mCanThreadExit || mSocket == -1) {
-        return;
+    // The payload would be zero padded, committing 0 for the signals it lacks.
+    if (frame.len < message.dlc) {
+        ALOGW("CAN ID 0x%x: %u bytes, its signals need %u", frame.can_id & CAN_EFF_MASK,
+              frame.len, message.dlc);
+        return false;
     }
 
-    fd_set rdfs;
-    char ctrlmsg[CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(__u32))];
-    struct can_frame frame = {
-        .can_dlc = CAN_MAX_DLEN
-    };
-    struct iovec iov = {
-        .iov_base = &frame
-    };
-    struct msghdr sock_msg = {
-        .msg_name = &mSockAddr,
-        .msg_iov = &iov,
-        .msg_iovlen = 1,
-        .msg_control = &ctrlmsg
-    };
-    ALOGD("CanRxHandleThread() ->");
+    float values[kCanMaxSignalsPerMessage];
+    decodeCanMessage(message, kCanSignals, frame.data, frame.len, values);
 
-    while (!mCanThreadExit) {
-        FD_ZERO(&rdfs);
-        FD_SET(mSocket, &rdfs);
+    const CanSignal* signals = &kCanSignals[message.firstSignal];
+    for (size_t i = 0; i < message.signalCount; i++) {
+        auto indexIt = mCanRxIndex.find(signals[i].prop);
+        if (indexIt == mCanRxIndex.end()) {
+            continue;
+        }
 
-        if (select(mSocket+1, &rdfs, NULL, NULL, NULL) <= 0) {
-            ALOGI("SELECT failed, errno %d ...", errno);
-            break;
+        auto internalPropValue = mPropStore->readValueOrNull(signals[i].prop, signals[i].areaId);
+        if (internalPropValue == nullptr) {
+            continue;
         }
 
-        if (FD_ISSET(mSocket, &rdfs)) {
-            iov.iov_len = sizeof(frame);
+        const bool changed = isPhysicalValueChanged(*internalPropValue, values[i],
+                                                    indexIt->second.deadband);
+        setPhysicalValue(internalPropValue.get(), values[i]);
+        internalPropValue->timestamp = timestamp;
+        commitCanValue(bus, indexIt->second, *internalPropValue, changed, events);
+    }
+    return true;
+}
+
+bool VehicleHalImpl::handleIsoTpFrame(CanBus& bus, const struct canfd_frame& frame, int64_t timestamp,
+                                      std::vector<VehiclePropValuePtr>& events)
+{
+    if (mIsoTpReceiver.onFrame(frame.data, frame.len, timestamp) != IsoTpReceiver::Result::COMPLETE) {
+        return true;
+    }
+
+    const uint8_t* message = mIsoTpReceiver.message();
+    const size_t length = mIsoTpReceiver.messageLength();
 
-            sock_msg.msg_namelen = sizeof(mSockAddr);
-            sock_msg.msg_controllen = sizeof(ctrlmsg);
-            sock_msg.msg_flags = 0;
+    vhal_isotp_msg_hdr_t hdr;
+    if (length < sizeof(hdr)) {
+        ALOGW("Malformed ISO-TP message of %zu bytes", length);
+        return true;
+    }
+    std::memcpy(&hdr, message, sizeof(hdr));
 
-            int bytes = recvmsg(mSocket, &sock_msg, 0);
+    VHAL_TRACE(ISOTP_RX, hdr.propId, hdr.areaId, length, 0);
 
-            if (bytes < 0) {
-                if ((errno == ENETDOWN) && !mCanThreadExit) {
-                    ALOGE("CAN interface is down");
-                    continue;
-                }
+    auto indexIt = mCanRxIndex.find(hdr.propId);
+    if (indexIt == mCanRxIndex.end()) {
+        ALOGW("ISO-TP message for unknown prop 0x%x", hdr.propId);
+        return true;
+    }
+    const CanRxProperty& rxProperty = indexIt->second;
+
+    auto internalPropValue = mPropStore->readValueOrNull(hdr.propId, hdr.areaId);
+    if (internalPropValue == nullptr) {
+        return true;
+    }
+
+    VehiclePropValue::RawValue previous;
+    if (rxProperty.onChange) {
+        previous = internalPropValue->value;
+    }
+
+    if (!decodeIsoTpMessage(message, length, internalPropValue.get())) {
+        ALOGW("Malformed ISO-TP message for prop 0x%x", hdr.propId);
+        return true;
+    }
+
+    const bool changed = !rxProperty.onChange
+            || isRawValueChanged(previous, internalPropValue->value, rxProperty.deadband);
+    internalPropValue->timestamp = timestamp;
+    commitCanValue(bus, rxProperty, *internalPropValue, changed, events);
+    return true;
+}
 
-                ALOGE("CAN socket read error %d", bytes);
-                break;
+bool VehicleHalImpl::sendIsoTpMessage(const VehiclePropValue& propValue)
+{
+    if (mIsoTpTxEvent == -1) {
+        return false;
+    }
+
+    std::vector<uint8_t> message(kVhalIsoTpMaxMessageSize);
+    size_t length = encodeIsoTpMessage(propValue, message.data(), message.size());
+    if (length == 0) {
+        ALOGW("Value of prop 0x%x exceeds %zu bytes", propValue.prop, kVhalIsoTpMaxMessageSize);
+        return false;
+    }
+    message.resize(length);
+    VHAL_TRACE(ISOTP_TX, propValue.prop, propValue.areaId, length, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mIsoTpTxLock);
+        if (mIsoTpTxQueue.size() == kIsoTpTxMaxQueued) {
+            ALOGW("ISO-TP TX queue is full, prop 0x%x is not sent", propValue.prop);
+            return false;
+        }
+        mIsoTpTxQueue.push_back(std::move(message));
+    }
+
+    EventLoop::notify(mIsoTpTxEvent);
+    return true;
+}
+
+void VehicleHalImpl::pumpIsoTpTx(void)
+{
+    const size_t frameSize = mIsoTpBus->isFd() ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+
+    for (;;) {
+        if (mIsoTpSender.isIdle()) {
+            std::vector<uint8_t> message;
+            {
+                std::lock_guard<std::mutex> lock(mIsoTpTxLock);
+                if (mIsoTpTxQueue.empty()) {
+                    return;
+                }
+                message = std::move(mIsoTpTxQueue.front());
+                mIsoTpTxQueue.pop_front();
             }
 
-            vhal_can_msg_t* pmsg = reinterpret_cast<vhal_can_msg_t*>(&frame.data);
-
-            ALOGD("RX: prop = 0x%08x, val = 0x%08x", pmsg->propId, pmsg->propValue);
-
-            std::vector<VehiclePropValue> propValues = mPropStore->readAllValues();
-            for (size_t i = 0; i < propValues.size(); i++) {
-                VehiclePropValue &propValue = propValues[i];
-                if (propValue.prop == pmsg->propId) {
-                    if (propValue.value.int32Values.size() != 0) {
-                        propValue.value.int32Values[0] = static_cast<int32_t>(pmsg->propValue);
-                    } else if (propValue.value.floatValues.size() != 0){
-                        propValue.value.floatValues[0] = (float)pmsg->propValue;
-                    } else if (propValue.value.int64Values.size() != 0){
-                        ALOGW("TODO: INT64 values receive is unsupported by now");
-                    } else if(propValue.value.bytes.size() != 0){
-                        ALOGW("TODO: BYTE-array send is unsupported by now");
-                    }
-
-                    propValue.timestamp = elapsedRealtimeNano();
-
-                    if (mPropStore->writeValue(propValue, true)) {
-                        if (getValuePool() != NULL) {
-                            doHalEvent(getValuePool()->obtain(propValue));
-                        } else {
-                            ALOGW("getValuePool() == NULL: propId: 0x%x", propValue.prop);
-                        }
-                    }
-                    break;
+            if (!mIsoTpSender.start(message.data(), message.size(), frameSize)) {
+                if (errno == ENOBUFS || errno == EAGAIN) {
+                    // The controller queue is full, keep the message first in line.
+                    std::lock_guard<std::mutex> lock(mIsoTpTxLock);
+                    mIsoTpTxQueue.push_front(std::move(message));
+                    EventLoop::armTimer(mIsoTpTxTimer, kIsoTpMinBackoff);
+                    return;
                 }
+                continue;
             }
         }
-    }
 
-    ALOGD("CanRxHandleThread() <-");
+        std::chrono::nanoseconds delay = mIsoTpSender.poll();
+        if (!mIsoTpSender.isIdle()) {
+            EventLoop::armTimer(mIsoTpTxTimer, delay);
+            return;
+        }
+    }
 }
 
-void VehicleHalImpl::CanTxBytes(void* bytesPtr, size_t bytesCount)
+void VehicleHalImpl::commitCanValue(CanBus& bus, const CanRxProperty& rxProperty,
+                                    const VehiclePropValue& propValue, bool changed,
+                                    std::vector<VehiclePropValuePtr>& events)
 {
-    if (mSocket == -1) {
+    // ECUs re-broadcast their state every cycle. The store keeps the
+    // timestamp of the last real change, which is what get() should report.
+    VHAL_TRACE(PROP_EVENT, propValue.prop, propValue.areaId, getPhysicalValue(propValue),
+               !rxProperty.onChange || changed);
+
+    if (rxProperty.onChange && !changed) {
+        bus.stats().suppressed++;
         return;
     }
 
-    struct can_frame frame = {
-        .can_dlc = CAN_MAX_DLEN
-    };
+    if (mPropStore->writeValue(propValue, true)) {
+        if (getValuePool() != NULL) {
+            events.push_back(getValuePool()->obtain(propValue));
+        } else {
+            ALOGW("getValuePool() == NULL: propId: 0x%x", propValue.prop);
+        }
+
+        const size_t slot = mPropStore->slotOf(propValue.prop, propValue.areaId);
+        if (mGating.controls(slot)) {
+            queueAvailabilityChanges(slot, events);
+        }
+    }
+}
 
-    if (frame.can_dlc > bytesCount){
-        frame.can_dlc = bytesCount;
+void VehicleHalImpl::queueAvailabilityChanges(size_t controlSlot,
+                                              std::vector<VehiclePropValuePtr>& events)
+{
+    std::vector<PropertyGating::Change> changes;
+    mGating.update(controlSlot, changes);
+    if (changes.empty() || getValuePool() == NULL) {
+        return;
     }
 
-    std::memcpy(&frame.data, bytesPtr, frame.can_dlc);
+    // Subscribers learn about it through the status of a fresh event.
+    for (auto& change : changes) {
+        auto value = mPropStore->readSlotOrNull(change.slot);
+        if (value == nullptr) {
+            continue;
+        }
+        value->timestamp = elapsedRealtimeNano();
+        value->status = change.available ? VehiclePropertyStatus::AVAILABLE
+                                         : VehiclePropertyStatus::UNAVAILABLE;
+        ALOGI("Prop 0x%x area 0x%x is %savailable", value->prop, value->areaId,
+              change.available ? "" : "not ");
+        events.push_back(getValuePool()->obtain(*value));
+    }
+}
 
-    if (send(mSocket, &frame, CAN_MTU, 0) < 0 ) {
-        ALOGE("Send %d bytes failed, error %d", frame.can_dlc, errno);
-    } else {
-        ALOGD("CAN sent %d bytes", frame.can_dlc);
+void VehicleHalImpl::queueCanFrame(CanBus& bus, const struct canfd_frame& frame, size_t mtu,
+                                   int64_t timestamp)
+{
+    // Flow control drives the ISO-TP sender, which lives on this thread.
+    if (frame.can_id == kCanIsoTpRxId && frame.len != 0
+            && isoTpPci(frame.data) == IsoTpPci::FLOW_CONTROL) {
+        bus.stats().accepted++;
+        mIsoTpSender.onFlowControl(frame.data, frame.len);
+        pumpIsoTpTx();
+        return;
     }
+
+    CanRxRecord* record = mCanRxRing.acquire();
+    if (record == nullptr) {
+        bus.stats().backlogged++;
+        return;
+    }
+
+    record->bus = &bus;
+    record->timestamp = timestamp;
+    record->mtu = mtu;
+    std::memcpy(&record->frame, &frame, sizeof(frame));
+    mCanRxRing.publish();
+    mCanRxQueued++;
 }
 
-void VehicleHalImpl::GpioHandleThread(void)
+void VehicleHalImpl::wakeCanDispatch(void)
 {
-    if (mGpioThreadExit) {
+    // One wakeup per received batch, the dispatch thread drains whatever is queued.
+    if (mCanRxQueued == 0 && !mCanDispatchExit) {
         return;
     }
+    mCanRxQueued = 0;
+
+    const uint64_t one = 1;
+    if (write(mCanDispatchFd, &one, sizeof(one)) < 0) {
+        ALOGE("CAN dispatch wakeup failed (error %d)", errno);
+    }
+}
+
+void VehicleHalImpl::CanDispatchThread(void)
+{
+    while (!mCanDispatchExit) {
+        uint64_t wakeups;
+        if (read(mCanDispatchFd, &wakeups, sizeof(wakeups)) < 0 && errno != EINTR) {
+            ALOGE("CAN dispatch wait failed (error %d)", errno);
+            break;
+        }
+
+        while (CanRxRecord* record = mCanRxRing.peek()) {
+            CanBus::Stats& stats = record->bus->stats();
+            if (handleCanFrame(*record->bus, record->frame, record->mtu, record->timestamp,
+                               mCanRxEvents)) {
+                stats.accepted++;
+            } else {
+                stats.dropped++;
+            }
+            mCanRxRing.release();
+
+            if (mCanRxEvents.size() >= mConfig.canRxBatchSize) {
+                flushCanRxEvents();
+            }
+        }
+        flushCanRxEvents();
+    }
+}
 
-    ALOGD("GpioHandleThread() ->");
+void VehicleHalImpl::flushCanRxEvents(void)
+{
+    // Hand the whole burst over back-to-back, so the HAL manager
+    // delivers it to subscribers as one batch.
+    for (auto& event : mCanRxEvents) {
+        const int32_t prop = event->prop;
+        const int64_t receivedAt = event->timestamp;
+        doHalEvent(std::move(event));
+        LatencyStats::record(LatencyStage::RX_TO_EVENT, prop, elapsedRealtimeNano() - receivedAt);
+    }
+    mCanRxEvents.clear();
+}
 
-    constexpr size_t maxRetry {12};
-    std::chrono::milliseconds timeout {1};
-    int fd = -1;
-    for (size_t i = 0; i < maxRetry && fd < 0 && !mGpioThreadExit; ++i) {
-        fd = open("/dev/input/event0", O_RDONLY);
-        if (fd < 0) {
-            ALOGW("Could not open input event device, attempt %zu, error: %s.", i, strerror(errno));
-            std::this_thread::sleep_for(timeout);
-            timeout *= 2;
+void VehicleHalImpl::sendCanSignals(const VehiclePropValue& propValue, const CanMessage& message,
+                                    const CanTxPolicy& policy)
+{
+    // The other signals of the message repeat their current values.
+    uint8_t data[CAN_MAX_DLEN] = {};
+    const CanSignal* signals = &kCanSignals[message.firstSignal];
+    for (size_t i = 0; i < message.signalCount; i++) {
+        const CanSignal& signal = signals[i];
+        float value = 0.0f;
+
+        if (signal.prop == propValue.prop && signal.areaId == propValue.areaId) {
+            value = getPhysicalValue(propValue);
+        } else {
+            auto internalPropValue = mPropStore->readValueOrNull(signal.prop, signal.areaId);
+            if (internalPropValue != nullptr) {
+                value = getPhysicalValue(*internalPropValue);
+            }
         }
+        encodeCanSignal(signal, value, data);
     }
-    if (fd < 0) {
-        ALOGE("Could not open input event device, after %zu retry. Exit from GPIO thread.", maxRetry);
+
+    VehicleHalImpl::CanTxBytes(message.canId, data, message.dlc, 0, policy);
+}
+
+void VehicleHalImpl::CanTxBytes(canid_t canId, const void* bytesPtr, size_t bytesCount,
+                                int32_t areaId, const CanTxPolicy& policy)
+{
+    // Frames still waiting for the same CAN ID and area are superseded by this one.
+    const uint64_t key = (uint64_t(canId) << 32) | static_cast<uint32_t>(areaId);
+    VHAL_TRACE(CAN_QUEUE, canId, areaId, bytesCount, 0);
+    canBusFor(canId)->queue(key, canId, bytesPtr, bytesCount, policy);
+}
+
+void VehicleHalImpl::dump(int fd)
+{
+    LatencyStats::dump(fd);
+    mPropertyTimer.dump(fd);
+
+#if VHAL_TRACE_ENABLED
+    TraceRing::instance().dump(fd);
+#else
+    dprintf(fd, "Trace: not built in, see VHAL_TRACE_ENABLED\n");
+#endif
+}
+
+void VehicleHalImpl::openGpioDevice(void)
+{
+    static constexpr size_t maxRetry {12};
+
+    mGpioFd = open("/dev/input/event0", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (mGpioFd < 0) {
+        if (++mGpioRetries < maxRetry && mGpioRetryTimer != -1) {
+            ALOGW("Could not open input event device, attempt %zu, error: %s.",
+                  mGpioRetries, strerror(errno));
+            EventLoop::armTimer(mGpioRetryTimer, std::chrono::milliseconds(1 << (mGpioRetries - 1)));
+        } else {
+            ALOGE("Could not open input event device, after %zu retry.", maxRetry);
+        }
         return;
     }
 
     unsigned char key_bitmask[SIZEOF_BIT_ARRAY(KEY_MAX + 1)];
     std::memset(key_bitmask, 0, sizeof(key_bitmask));
 
-    struct pollfd fds = {
-        .fd = fd,
-        .events = POLLIN,
-        .revents = POLLOUT
-    };
-
     /**
      * Here is we check initial GPIO switches state
      * in case we want to boot up straight into
      * the EVS app.
      */
-    onGpioStateChanged(fd, key_bitmask, sizeof(key_bitmask));
+    onGpioStateChanged(mGpioFd, key_bitmask, sizeof(key_bitmask));
 
-    while (!mGpioThreadExit) {
-        if (poll(&fds, 1, -1) > 0) {
-            if (read(fds.fd, key_bitmask, sizeof(key_bitmask)) > 0) {
-                onGpioStateChanged(fd, key_bitmask, sizeof(key_bitmask));
-            }
-        }
-    }
+    mEventLoop.addFd(mGpioFd, EPOLLIN, [this](uint32_t) { GpioHandle(); });
+}
 
-    close(fd);
+void VehicleHalImpl::GpioHandle(void)
+{
+    unsigned char key_bitmask[SIZEOF_BIT_ARRAY(KEY_MAX + 1)];
+    std::memset(key_bitmask, 0, sizeof(key_bitmask));
 
-    ALOGD("GpioHandleThread() <-");
+    if (read(mGpioFd, key_bitmask, sizeof(key_bitmask)) > 0) {
+        onGpioStateChanged(mGpioFd, key_bitmask, sizeof(key_bitmask));
+    }
 }
 
 }  // namespace renesas
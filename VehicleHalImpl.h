@@ -17,26 +17,39 @@
 #ifndef _VehicleHal_H_
 #define _VehicleHal_H_
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
 
 #include <inttypes.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <net/if.h>
 #include <memory.h>
-#include <poll.h>
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <linux/input.h>
 #include <linux/input-event-codes.h>
 
-#include <vhal_v2_0/RecurrentTimer.h>
 #include <vhal_v2_0/VehicleHal.h>
-#include <vhal_v2_0/VehiclePropertyStore.h>
+
+#include "CanBus.h"
+#include "CanProtocol.h"
+#include "CanSignalCodec.h"
+#include "EventLoop.h"
+#include "IsoTp.h"
+#include "PropertyGating.h"
+#include "PropertyMetadata.h"
+#include "SpscRing.h"
+#include "StaticPropertyStore.h"
+#include "TimerWheel.h"
+#include "VehicleHalConfig.h"
 
 namespace android {
 namespace hardware {
@@ -47,7 +60,8 @@ namespace renesas {
 
 class VehicleHalImpl : public VehicleHal {
 public:
-    VehicleHalImpl(VehiclePropertyStore* propStore);
+    VehicleHalImpl(StaticPropertyStore* propStore,
+                   const VehicleHalConfig& config = VehicleHalConfig::fromSystemProperties());
     virtual ~VehicleHalImpl(void);
 
     virtual std::vector<VehiclePropConfig> listProperties() override;
@@ -58,28 +72,101 @@ public:
     virtual StatusCode unsubscribe(int32_t property) override;
     virtual void onCreate() override;
 
-    void GpioHandleThread(void);
-    void CanRxHandleThread(void);
-    void CanTxBytes(void* bytesPtr, size_t bytesCount);
+    /* Writes the debug state (lshal debug) to fd. */
+    void dump(int fd);
+
+    size_t canBusCount(void) const { return mCanBuses.size(); }
+    const CanBus& canBus(size_t index) const { return *mCanBuses[index]; }
+
+    void GpioHandle(void);
+    void CanTxBytes(canid_t canId, const void* bytesPtr, size_t bytesCount, int32_t areaId = 0,
+                    const CanTxPolicy& policy = CanTxPolicy());
 
 private:
+    // Drives onContinuousPropertyTimer() directly, see benchmarks/HalBenchmark.cpp.
+    friend struct HalBenchmarkAccess;
+
+    struct CanRxProperty {
+        int32_t     areaId;     // store slot updated by messages that carry no area
+        bool        onChange;   // suppress events that do not change the value
+        float       deadband;   // of float values, in property units
+        std::vector<int32_t> areaIds;   // in declaration order, area index n is areaIds[n - 1]
+    };
+
+    /* Frame handed over from the event loop to the dispatch thread. */
+    struct CanRxRecord {
+        CanBus*             bus;
+        int64_t             timestamp;
+        size_t              mtu;
+        struct canfd_frame  frame;
+    };
+
     constexpr std::chrono::nanoseconds hertzToNanoseconds(float hz) const {
         return std::chrono::nanoseconds(static_cast<int64_t>(1000000000L / hz));
     }
 
     void onGpioStateChanged(int fd, unsigned char* const key_bitmask, size_t array_len);
     void onContinuousPropertyTimer(const std::vector<int32_t>& properties);
-    bool isContinuousProperty(int32_t propId) const;
-
-    VehiclePropertyStore*           mPropStore;
-    std::unordered_set<int32_t>     mHvacPowerProps;
-    RecurrentTimer                  mRecurrentTimer;
-    int                             mSocket;
-    struct sockaddr_can             mSockAddr;
-    std::thread                     mCanThread;
-    std::atomic<bool>               mCanThreadExit;
-    std::thread                     mGpioThread;
-    std::atomic<bool>               mGpioThreadExit;
+    const PropertyMetadata* continuousProperty(int32_t propId) const;
+
+    void buildCanRxIndex(void);
+    void buildCanRoutes(void);
+    std::vector<struct can_filter> canRxFilters(const CanBus* bus) const;
+    CanBus* canBusFor(canid_t canId) const;
+    void openGpioDevice(void);
+    bool handleCanFrame(CanBus& bus, const struct canfd_frame& frame, size_t mtu, int64_t timestamp,
+                        std::vector<VehiclePropValuePtr>& events);
+    bool handleCanFdAreaFrame(CanBus& bus, const vhal_canfd_msg_t& msg, size_t length,
+                              int64_t timestamp, std::vector<VehiclePropValuePtr>& events);
+    bool handleCanSignalFrame(CanBus& bus, const CanMessage& message, const struct canfd_frame& frame,
+                              int64_t timestamp, std::vector<VehiclePropValuePtr>& events);
+    void commitCanValue(CanBus& bus, const CanRxProperty& rxProperty,
+                        const VehiclePropValue& propValue, bool changed,
+                        std::vector<VehiclePropValuePtr>& events);
+    bool handleIsoTpFrame(CanBus& bus, const struct canfd_frame& frame, int64_t timestamp,
+                          std::vector<VehiclePropValuePtr>& events);
+    bool sendIsoTpMessage(const VehiclePropValue& propValue);
+    void pumpIsoTpTx(void);
+    void queueCanFrame(CanBus& bus, const struct canfd_frame& frame, size_t mtu, int64_t timestamp);
+    void wakeCanDispatch(void);
+    void CanDispatchThread(void);
+    void flushCanRxEvents(void);
+    void queueAvailabilityChanges(size_t controlSlot, std::vector<VehiclePropValuePtr>& events);
+    void sendCanSignals(const VehiclePropValue& propValue, const CanMessage& message,
+                        const CanTxPolicy& policy);
+
+    const VehicleHalConfig          mConfig;
+    StaticPropertyStore*            mPropStore;
+    PropertyMetadataTable           mMetadata;
+    PropertyGating                  mGating;
+    // propId -> how incoming CAN messages update the property
+    std::unordered_map<int32_t, CanRxProperty> mCanRxIndex;
+    // propId -> scheduling of the frames set() sends
+    std::unordered_map<int32_t, CanTxPolicy> mCanTxPolicies;
+    EventLoop                       mEventLoop;
+    TimerWheel                      mPropertyTimer;
+    std::vector<std::unique_ptr<CanBus>> mCanBuses;
+    // CAN ID -> bus carrying it, both for TX and for the RX filter of the bus
+    std::unordered_map<canid_t, CanBus*> mCanRoutes;
+    // Reception on the event loop, decoding and doHalEvent() on the dispatch
+    // thread, so a slow store or subscriber does not stall socket draining.
+    SpscRing<CanRxRecord>           mCanRxRing;
+    size_t                          mCanRxQueued;       // since the dispatch thread was woken
+    std::vector<VehiclePropValuePtr> mCanRxEvents;      // dispatch thread only
+    int                             mCanDispatchFd;
+    std::atomic<bool>               mCanDispatchExit;
+    std::thread                     mCanDispatchThread;
+    // ISO-TP: reassembly on the dispatch thread, segmentation on the event loop
+    CanBus*                         mIsoTpBus;
+    IsoTpReceiver                   mIsoTpReceiver;
+    IsoTpSender                     mIsoTpSender;
+    std::mutex                      mIsoTpTxLock;
+    std::deque<std::vector<uint8_t>> mIsoTpTxQueue;
+    int                             mIsoTpTxEvent;
+    int                             mIsoTpTxTimer;
+    int                             mGpioFd;
+    int                             mGpioRetryTimer;
+    size_t                          mGpioRetries;
 };
 
 }  // namespace renesas
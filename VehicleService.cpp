@@ -30,10 +30,26 @@ using namespace android;
 using namespace android::hardware;
 using namespace android::hardware::automotive::vehicle::V2_0;
 
+/* Routes "lshal debug" of the service to the HAL. */
+class VehicleService : public VehicleHalManager {
+public:
+    explicit VehicleService(renesas::VehicleHalImpl* hal) : VehicleHalManager(hal), mHal(hal) {}
+
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& /* options */) override {
+        if (fd.getNativeHandle() != nullptr && fd->numFds > 0) {
+            mHal->dump(fd->data[0]);
+        }
+        return Void();
+    }
+
+private:
+    renesas::VehicleHalImpl* mHal;
+};
+
 int main(int /* argc */, char* /* argv */ []) {
-    auto store = std::make_unique<VehiclePropertyStore>();
+    auto store = std::make_unique<renesas::StaticPropertyStore>();
     auto hal = std::make_unique<renesas::VehicleHalImpl>(store.get());
-    auto service = std::make_unique<VehicleHalManager>(hal.get());
+    auto service = std::make_unique<VehicleService>(hal.get());
 
     configureRpcThreadpool(4, true /* callerWillJoin */);
 
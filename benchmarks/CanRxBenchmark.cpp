@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "CanProtocol.h"
+#include "DefaultCanConfig.h"
+#include "DefaultConfig.h"
+#include "VcanHarness.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* Which CAN IDs the vehicle side sends. */
+enum class CanIdMix {
+    SINGLE = 0,     // one VHAL message ID
+    VHAL = 1,       // VHAL messages of all scalar properties, round robin
+    SIGNALS = 2,    // signal codec messages (DefaultCanConfig.h)
+    MIXED = 3,      // both of the above
+};
+
+static constexpr size_t kFramesPerIteration = 1000;
+
+static bool isSignalProperty(int32_t prop)
+{
+    for (auto& signal : kCanSignals) {
+        if (signal.prop == prop) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::vector<struct can_frame> buildFrames(CanIdMix mix)
+{
+    std::vector<struct can_frame> frames;
+
+    if (mix != CanIdMix::SIGNALS) {
+        for (auto& it : kVehicleProperties) {
+            const int32_t prop = it.config.prop;
+            const VehiclePropertyType type = getPropType(prop);
+            if ((type != VehiclePropertyType::INT32 && type != VehiclePropertyType::FLOAT
+                    && type != VehiclePropertyType::BOOLEAN) || isSignalProperty(prop)) {
+                continue;
+            }
+
+            struct can_frame frame = {};
+            frame.can_id = canIdForProperty(prop);
+            frame.can_dlc = sizeof(vhal_can_msg_t);
+            const vhal_can_msg_t msg = {prop, 0};
+            std::memcpy(frame.data, &msg, sizeof(msg));
+            frames.push_back(frame);
+
+            if (mix == CanIdMix::SINGLE) {
+                break;
+            }
+        }
+    }
+
+    if (mix == CanIdMix::SIGNALS || mix == CanIdMix::MIXED) {
+        for (auto& message : kCanMessages) {
+            struct can_frame frame = {};
+            frame.can_id = message.canId;
+            frame.can_dlc = message.dlc;
+            frames.push_back(frame);
+        }
+    }
+    return frames;
+}
+
+/* Changes the payload every time, so ON_CHANGE suppression does not hide the work. */
+static void updatePayload(struct can_frame* frame, uint32_t sequence)
+{
+    if (isVhalCanId(frame->can_id)) {
+        std::memcpy(frame->data + offsetof(vhal_can_msg_t, propValue), &sequence, sizeof(sequence));
+    } else {
+        for (size_t i = 0; i < frame->can_dlc; i++) {
+            frame->data[i] = static_cast<uint8_t>(sequence >> (i % 4));
+        }
+    }
+}
+
+/*
+ * Vehicle side of the bus sending frames at a fixed rate (range(0), frames
+ * per second, 0 - as fast as the socket takes them) with the CAN ID mix of
+ * range(1). Reports what the HAL got through and what it cost.
+ */
+static void BM_CanRx(benchmark::State& state)
+{
+    const int64_t rate = state.range(0);
+    const CanIdMix mix = static_cast<CanIdMix>(state.range(1));
+
+    VcanHarness harness;
+    if (!harness.isReady()) {
+        state.SkipWithError("vcan interface is not available (needs root and the vcan module)");
+        return;
+    }
+    int sock = harness.openPeerSocket({});  // no filters: send only
+    if (sock < 0) {
+        state.SkipWithError("Could not open the vehicle side socket");
+        return;
+    }
+
+    std::vector<struct can_frame> frames = buildFrames(mix);
+    const auto period = std::chrono::nanoseconds((rate > 0) ? 1000000000LL / rate : 0);
+    uint64_t sent = 0;
+    uint64_t retries = 0;
+    uint32_t sequence = 0;
+
+    const CanBus::Stats& stats = harness.busStats();
+    const uint64_t receivedBefore = stats.received;
+    const uint64_t eventsBefore = harness.events();
+    const int64_t processCpuBefore = processCpuTimeNs();
+    const int64_t senderCpuBefore = threadCpuTimeNs();
+    harness.takeEventLatency();
+
+    auto next = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        for (size_t i = 0; i < kFramesPerIteration; i++) {
+            struct can_frame& frame = frames[sequence % frames.size()];
+            updatePayload(&frame, sequence++);
+
+            if (period.count() != 0) {
+                next += period;
+                std::this_thread::sleep_until(next);
+            }
+            while (write(sock, &frame, CAN_MTU) < 0) {
+                if (errno != ENOBUFS && errno != EAGAIN) {
+                    state.SkipWithError("Send to vcan failed");
+                    close(sock);
+                    return;
+                }
+                retries++;
+                std::this_thread::yield();
+            }
+            sent++;
+        }
+    }
+    harness.waitForIdle(std::chrono::seconds(2));
+
+    const uint64_t received = stats.received - receivedBefore;
+    const int64_t halCpu = (processCpuTimeNs() - processCpuBefore)
+            - (threadCpuTimeNs() - senderCpuBefore);
+    const LatencyHistogram latency = harness.takeEventLatency();
+
+    state.counters["frames/s"] = benchmark::Counter(received, benchmark::Counter::kIsRate);
+    state.counters["dropped"] = (sent - std::min(sent, received)) + stats.backlogged.load();
+    state.counters["send_retries"] = retries;
+    state.counters["events"] = harness.events() - eventsBefore;
+    state.counters["cpu_ns/frame"] = (received != 0) ? double(halCpu) / received : 0.0;
+    state.counters["latency_p50_us"] = latency.percentile(0.5) / 1000.0;
+    state.counters["latency_p99_us"] = latency.percentile(0.99) / 1000.0;
+    state.counters["latency_max_us"] = latency.max() / 1000.0;
+
+    close(sock);
+}
+
+static void canRxArgs(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t rate : {1000, 10000, 0}) {
+        for (CanIdMix mix : {CanIdMix::SINGLE, CanIdMix::VHAL, CanIdMix::SIGNALS, CanIdMix::MIXED}) {
+            benchmark->Args({rate, static_cast<int64_t>(mix)});
+        }
+    }
+}
+
+BENCHMARK(BM_CanRx)
+    ->ArgNames({"rate", "mix"})
+    ->Apply(canRxArgs)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
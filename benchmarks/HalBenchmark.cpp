@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <utils/SystemClock.h>
+#include <vhal_v2_0/VehicleObjectPool.h>
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "CanProtocol.h"
+#include "DefaultConfig.h"
+#include "IsoTp.h"
+#include "VehicleHalImpl.h"
+
+/*
+ * Heap allocations of the calling thread, so allocations/op of one benchmark
+ * thread are not mixed with those of the others.
+ */
+static thread_local uint64_t tAllocations = 0;
+
+void* operator new(size_t size)
+{
+    tAllocations++;
+    void* ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr == nullptr) {
+        std::abort();   // built without exceptions
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+struct HalBenchmarkAccess {
+    static void onContinuousPropertyTimer(VehicleHalImpl& hal, const std::vector<int32_t>& props)
+    {
+        hal.onContinuousPropertyTimer(props);
+    }
+
+    static CanBus& canBus(VehicleHalImpl& hal, size_t index) { return *hal.mCanBuses[index]; }
+};
+
+/*
+ * The HAL under test. One end of a socketpair stands in for the socket of
+ * its CAN interface, so set() goes through the TX queue and the event loop
+ * as on a vehicle. A peer thread takes the frames off the other end and
+ * grants ISO-TP flow control, as the gateway would.
+ */
+class StandInHal {
+public:
+    static StandInHal& instance(void)
+    {
+        static StandInHal hal;
+        return hal;
+    }
+
+    ~StandInHal(void)
+    {
+        mHal.reset();   // Closes the HAL's end, which ends the peer thread.
+        if (mPeerThread.joinable()) {
+            mPeerThread.join();
+        }
+        if (mPeer != -1) {
+            close(mPeer);
+        }
+    }
+
+    VehicleHalImpl& hal(void) { return *mHal; }
+    StaticPropertyStore& store(void) { return mStore; }
+
+private:
+    StandInHal(void) :
+        mPeer(-1)
+    {
+        VehicleHalConfig config;
+        config.canInterfaces = {"vhalstandin0"};
+        mHal = std::make_unique<VehicleHalImpl>(&mStore, config);
+
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == 0) {
+            HalBenchmarkAccess::canBus(*mHal, 0).adoptSocket(fds[0]);
+            mPeer = fds[1];
+            mPeerThread = std::thread(&StandInHal::runPeer, this);
+        }   // else the bus stays offline and set() stops short of the TX queue
+
+        mHal->init(&mValuePool, [](VehicleHal::VehiclePropValuePtr) {},
+                   [](StatusCode, int32_t, int32_t) {});
+        mHal->onCreate();
+    }
+
+    void runPeer(void)
+    {
+        struct canfd_frame frame;
+
+        while (recv(mPeer, &frame, sizeof(frame), 0) > 0) {
+            if (frame.can_id != kCanIsoTpTxId || isoTpPci(frame.data) != IsoTpPci::FIRST) {
+                continue;
+            }
+
+            // Continue to send, with no block size and no STmin.
+            struct canfd_frame flowControl = {};
+            flowControl.can_id = kCanIsoTpRxId;
+            flowControl.len = CAN_MAX_DLEN;
+            std::memset(flowControl.data, kIsoTpPadding, CAN_MAX_DLEN);
+            flowControl.data[0] = static_cast<uint8_t>(IsoTpPci::FLOW_CONTROL) << 4;
+            flowControl.data[1] = 0;
+            flowControl.data[2] = 0;
+            send(mPeer, &flowControl, CAN_MTU, 0);
+        }
+    }
+
+    StaticPropertyStore             mStore;
+    VehiclePropValuePool            mValuePool;
+    std::unique_ptr<VehicleHalImpl> mHal;
+    int                             mPeer;
+    std::thread                     mPeerThread;
+};
+
+enum class PropKind {
+    INT32 = 0,
+    FLOAT = 1,
+    MULTI_AREA = 2,
+    STRING = 3,
+};
+
+/* The first property of kVehicleProperties of the kind, nullptr if there is none. */
+static const VehiclePropConfig* findProperty(PropKind kind)
+{
+    for (auto& it : kVehicleProperties) {
+        const VehiclePropConfig& cfg = it.config;
+        const VehiclePropertyType type = getPropType(cfg.prop);
+        const bool global = isGlobalProp(cfg.prop);
+
+        switch (kind) {
+            case PropKind::INT32:
+                if (global && type == VehiclePropertyType::INT32) {
+                    return &cfg;
+                }
+                break;
+            case PropKind::FLOAT:
+                if (global && type == VehiclePropertyType::FLOAT) {
+                    return &cfg;
+                }
+                break;
+            case PropKind::MULTI_AREA:
+                if (cfg.areaConfigs.size() > 1 && (type == VehiclePropertyType::INT32
+                        || type == VehiclePropertyType::FLOAT)) {
+                    return &cfg;
+                }
+                break;
+            case PropKind::STRING:
+                if (type == VehiclePropertyType::STRING) {
+                    return &cfg;
+                }
+                break;
+        }
+    }
+    return nullptr;
+}
+
+static std::vector<int32_t> areasOf(const VehiclePropConfig& cfg)
+{
+    std::vector<int32_t> areas;
+    for (auto& areaConfig : cfg.areaConfigs) {
+        areas.push_back(areaConfig.areaId);
+    }
+    if (areas.empty()) {
+        areas.push_back(0);
+    }
+    return areas;
+}
+
+static void reportAllocations(benchmark::State& state, uint64_t allocations)
+{
+    state.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+/* get() of the property kind range(0), from 1-8 binder threads. */
+static void BM_Get(benchmark::State& state)
+{
+    const VehiclePropConfig* cfg = findProperty(static_cast<PropKind>(state.range(0)));
+    if (cfg == nullptr) {
+        state.SkipWithError("No such property in kVehicleProperties");
+        return;
+    }
+    VehicleHalImpl& hal = StandInHal::instance().hal();
+    const std::vector<int32_t> areas = areasOf(*cfg);
+
+    VehiclePropValue request = {.prop = cfg->prop};
+    size_t i = 0;
+    const uint64_t allocations = tAllocations;
+
+    for (auto _ : state) {
+        request.areaId = areas[i++ % areas.size()];
+        StatusCode status;
+        auto value = hal.get(request, &status);
+        benchmark::DoNotOptimize(value);
+    }
+    reportAllocations(state, tAllocations - allocations);
+}
+
+/* set() of the current value of the property kind range(0), from 1-8 binder threads. */
+static void BM_Set(benchmark::State& state)
+{
+    const VehiclePropConfig* cfg = findProperty(static_cast<PropKind>(state.range(0)));
+    if (cfg == nullptr) {
+        state.SkipWithError("No such property in kVehicleProperties");
+        return;
+    }
+    VehicleHalImpl& hal = StandInHal::instance().hal();
+    std::vector<VehiclePropValue> values;
+    for (int32_t area : areasOf(*cfg)) {
+        StatusCode status;
+        auto value = hal.get(VehiclePropValue {.prop = cfg->prop, .areaId = area}, &status);
+        if (value != nullptr) {
+            values.push_back(*value);
+        }
+    }
+    if (values.empty()) {
+        state.SkipWithError("Property has no value");
+        return;
+    }
+
+    size_t i = 0;
+    const uint64_t allocations = tAllocations;
+
+    for (auto _ : state) {
+        VehiclePropValue& value = values[i++ % values.size()];
+        value.timestamp = elapsedRealtimeNano();     // the store refuses older values
+        benchmark::DoNotOptimize(hal.set(value));
+    }
+    reportAllocations(state, tAllocations - allocations);
+}
+
+/*
+ * Stands in for CanRxHandleThread: writes the value of one property into the
+ * store back to back while a benchmark runs. The first benchmark thread in
+ * starts it, the last one out stops it.
+ */
+class StoreWriter {
+public:
+    static void enter(StaticPropertyStore& store, const VehiclePropValue& value)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (sUsers++ == 0) {
+            sStop = false;
+            sWrites = 0;
+            sThread = std::thread([&store, written = value]() mutable {
+                while (!sStop.load(std::memory_order_relaxed)) {
+                    written.timestamp = elapsedRealtimeNano();
+                    if (!written.value.int32Values.empty()) {
+                        written.value.int32Values[0] ^= 1;
+                    }
+                    store.writeValue(written, true);
+                    sWrites.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+
+    /* Writes since the writer started, reported by the last thread out. */
+    static uint64_t leave(void)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (--sUsers != 0) {
+            return 0;
+        }
+        sStop = true;
+        sThread.join();
+        return sWrites.load();
+    }
+
+private:
+    static std::mutex               sMutex;
+    static int                      sUsers;
+    static std::thread              sThread;
+    static std::atomic<bool>        sStop;
+    static std::atomic<uint64_t>    sWrites;
+};
+
+std::mutex StoreWriter::sMutex;
+int StoreWriter::sUsers = 0;
+std::thread StoreWriter::sThread;
+std::atomic<bool> StoreWriter::sStop(false);
+std::atomic<uint64_t> StoreWriter::sWrites(0);
+
+/*
+ * get() of one int32 property from 1-8 binder threads while another thread
+ * keeps writing it, as CAN RX does. Readers do not take the slot lock, so the
+ * per thread rate should hold as threads are added; writes/s shows whether
+ * the writer is slowed down by the readers.
+ */
+static void BM_GetUnderCanWrites(benchmark::State& state)
+{
+    const VehiclePropConfig* cfg = findProperty(PropKind::INT32);
+    if (cfg == nullptr) {
+        state.SkipWithError("No such property in kVehicleProperties");
+        return;
+    }
+    StandInHal& standIn = StandInHal::instance();
+    VehicleHalImpl& hal = standIn.hal();
+
+    const VehiclePropValue request = {.prop = cfg->prop};
+    StatusCode status;
+    auto current = hal.get(request, &status);
+    if (current == nullptr) {
+        state.SkipWithError("Property has no value");
+        return;
+    }
+
+    StoreWriter::enter(standIn.store(), *current);
+    for (auto _ : state) {
+        auto value = hal.get(request, &status);
+        benchmark::DoNotOptimize(value);
+    }
+    const uint64_t writes = StoreWriter::leave();
+    if (writes != 0) {
+        state.counters["writes"] = benchmark::Counter(writes, benchmark::Counter::kIsRate);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_GetUnderCanWrites)->ThreadRange(1, 8)->UseRealTime();
+
+static void propKindArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgName("kind");
+    for (PropKind kind : {PropKind::INT32, PropKind::FLOAT, PropKind::MULTI_AREA, PropKind::STRING}) {
+        benchmark->Arg(static_cast<int64_t>(kind));
+    }
+    // configureRpcThreadpool(4, ...) serves up to four callers at once, go beyond to see the trend.
+    benchmark->ThreadRange(1, 8);
+}
+
+BENCHMARK(BM_Get)->Apply(propKindArgs)->UseRealTime();
+BENCHMARK(BM_Set)->Apply(propKindArgs)->UseRealTime();
+
+static std::vector<int32_t> continuousProperties(void)
+{
+    std::vector<int32_t> props;
+    for (auto& it : kVehicleProperties) {
+        if (it.config.changeMode == VehiclePropertyChangeMode::CONTINUOUS) {
+            props.push_back(it.config.prop);
+        }
+    }
+    return props;
+}
+
+/* subscribe() and unsubscribe() of every continuous property. */
+static void BM_SubscribeUnsubscribe(benchmark::State& state)
+{
+    VehicleHalImpl& hal = StandInHal::instance().hal();
+    const std::vector<int32_t> props = continuousProperties();
+    size_t i = 0;
+    const uint64_t allocations = tAllocations;
+
+    for (auto _ : state) {
+        const int32_t prop = props[i++ % props.size()];
+        hal.subscribe(prop, 1.0f);
+        hal.unsubscribe(prop);
+    }
+    reportAllocations(state, tAllocations - allocations);
+}
+
+BENCHMARK(BM_SubscribeUnsubscribe);
+
+/* One timer tick of range(0) continuous properties, as TimerWheel delivers it. */
+static void BM_ContinuousPropertyTimer(benchmark::State& state)
+{
+    VehicleHalImpl& hal = StandInHal::instance().hal();
+    std::vector<int32_t> props = continuousProperties();
+    props.resize(std::min<size_t>(props.size(), state.range(0)));
+    const uint64_t allocations = tAllocations;
+
+    for (auto _ : state) {
+        HalBenchmarkAccess::onContinuousPropertyTimer(hal, props);
+    }
+    reportAllocations(state, tAllocations - allocations);
+    state.SetItemsProcessed(state.iterations() * props.size());
+}
+
+BENCHMARK(BM_ContinuousPropertyTimer)->ArgName("props")->Arg(1)->Arg(4)->Arg(64);
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "CanProtocol.h"
+#include "IsoTp.h"
+#include "VcanHarness.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * The gateway side sends a string property of range(0) bytes as one ISO-TP
+ * message, in classic (range(1) == 0) or CAN FD frames, and waits for the
+ * HAL to report the new value. Measures whole-message throughput including
+ * flow control round trips.
+ */
+static void BM_IsoTpRx(benchmark::State& state)
+{
+    const size_t payload = state.range(0);
+    const bool fd = state.range(1) != 0;
+    const size_t frameSize = fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+
+    VcanHarness harness(fd);
+    if (!harness.isReady()) {
+        state.SkipWithError("vcan interface is not available (needs root and the vcan module)");
+        return;
+    }
+    int sock = harness.openPeerSocket({{kCanIsoTpTxId, CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_EFF_MASK}});
+    if (sock < 0) {
+        state.SkipWithError("Could not open the gateway side socket");
+        return;
+    }
+
+    IsoTpSender sender(kVhalIsoTpMaxMessageSize, [sock, fd](const uint8_t* data, size_t length) {
+        struct canfd_frame frame = {};
+        frame.can_id = kCanIsoTpRxId;
+        frame.len = length;
+        std::memcpy(frame.data, data, length);
+        return write(sock, &frame, fd ? CANFD_MTU : CAN_MTU) > 0;
+    });
+
+    VehiclePropValue value = {
+        .prop = toInt(VehicleProperty::INFO_MAKE),
+        .areaId = 0,
+    };
+    std::vector<uint8_t> message(kVhalIsoTpMaxMessageSize);
+    uint64_t expectedEvents = harness.events();
+    uint64_t bytes = 0;
+    char fill = 'a';
+
+    for (auto _ : state) {
+        value.value.stringValue = std::string(payload, fill);
+        fill = (fill == 'z') ? 'a' : fill + 1;
+        const size_t length = encodeIsoTpMessage(value, message.data(), message.size());
+
+        if (!sender.start(message.data(), length, frameSize)) {
+            state.SkipWithError("ISO-TP start failed");
+            break;
+        }
+        while (!sender.isIdle()) {
+            const auto delay = sender.poll();
+            struct pollfd pfd = {.fd = sock, .events = POLLIN, .revents = 0};
+            const int timeout = (delay.count() != 0)
+                    ? std::max<int>(1, std::chrono::duration_cast<std::chrono::milliseconds>(delay).count())
+                    : 100;
+            if (poll(&pfd, 1, sender.isIdle() ? 0 : timeout) > 0) {
+                struct canfd_frame frame;
+                if (read(sock, &frame, sizeof(frame)) > 0) {
+                    sender.onFlowControl(frame.data, frame.len);
+                }
+            }
+        }
+
+        if (!harness.waitForEvents(++expectedEvents, std::chrono::seconds(1))) {
+            state.SkipWithError("The HAL did not report the message");
+            break;
+        }
+        bytes += length;
+    }
+
+    state.SetBytesProcessed(bytes);
+    state.counters["messages/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["aborted"] = sender.stats().aborted.load();
+    close(sock);
+}
+
+BENCHMARK(BM_IsoTpRx)
+    ->ArgNames({"bytes", "fd"})
+    ->Args({1024, 0})
+    ->Args({4096, 0})
+    ->Args({1024, 1})
+    ->Args({4096, 1})
+    ->UseRealTime();
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
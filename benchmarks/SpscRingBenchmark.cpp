@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <linux/can.h>
+
+#include <benchmark/benchmark.h>
+
+#include "SpscRing.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* Same layout as the records VehicleHalImpl hands to its dispatch thread. */
+struct RingRecord {
+    void*               bus;
+    int64_t             timestamp;
+    size_t              mtu;
+    struct canfd_frame  frame;
+};
+
+static constexpr size_t kRecordsPerIteration = 4096;
+
+/*
+ * A producer thread pushes frames into a ring of range(0) records while the
+ * benchmark thread consumes them, as the event loop and the dispatch thread do.
+ */
+static void BM_SpscRingThroughput(benchmark::State& state)
+{
+    SpscRing<RingRecord> ring(state.range(0));
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> full(0);
+
+    std::thread producer([&ring, &stop, &full]() {
+        int64_t sequence = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            RingRecord* record = ring.acquire();
+            if (record == nullptr) {
+                full.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+                continue;
+            }
+            record->timestamp = sequence++;
+            record->mtu = CAN_MTU;
+            record->frame.can_id = static_cast<canid_t>(sequence);
+            ring.publish();
+        }
+    });
+
+    uint64_t consumed = 0;
+    int64_t checksum = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kRecordsPerIteration; ) {
+            RingRecord* record = ring.peek();
+            if (record == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            checksum += record->timestamp;
+            ring.release();
+            i++;
+        }
+        consumed += kRecordsPerIteration;
+    }
+    benchmark::DoNotOptimize(checksum);
+
+    stop = true;
+    producer.join();
+
+    state.SetItemsProcessed(consumed);
+    state.counters["producer_full_waits"] = full.load();
+}
+
+BENCHMARK(BM_SpscRingThroughput)
+    ->ArgName("capacity")
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(65536)
+    ->UseRealTime();
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <benchmark/benchmark.h>
+
+#include "EventLoop.h"
+#include "LatencyStats.h"
+#include "PropertyTimer.h"
+#include "TimerWheel.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+using Clock = std::chrono::steady_clock;
+
+// Sample rates of continuous properties, handed out round robin.
+static constexpr int kRatesHz[] = {1, 5, 10, 20, 25, 50, 100};
+
+static constexpr auto kRunTime = std::chrono::seconds(2);
+
+static int64_t cpuTimeNs(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+/*
+ * range(0) recurrent events on Timer for kRunTime, as subscribe() sets them
+ * up for continuous properties. Reported per second of run time:
+ *
+ *   batches    action calls, i.e. loop wakeups that delivered something
+ *   fired      cookies delivered
+ *   cpu        CPU time of the process (the loop thread) per second, in %
+ *   jitter_*   deviation of each period of a cookie from its interval, us
+ */
+template <typename Timer>
+static void BM_RecurrentTimer(benchmark::State& state)
+{
+    const size_t events = state.range(0);
+    std::vector<std::chrono::nanoseconds> intervals(events);
+    std::vector<Clock::time_point> lastFired(events);
+    LatencyHistogram jitter;
+    uint64_t batches = 0;
+    uint64_t fired = 0;
+
+    EventLoop loop;
+    Timer timer(loop, [&](const std::vector<int32_t>& cookies) {
+        const Clock::time_point now = Clock::now();
+        batches++;
+        fired += cookies.size();
+        for (int32_t cookie : cookies) {
+            if (lastFired[cookie] != Clock::time_point()) {
+                jitter.record(std::abs((now - lastFired[cookie] - intervals[cookie]).count()));
+            }
+            lastFired[cookie] = now;
+        }
+    });
+    loop.start();
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < events; i++) {
+            const int hz = kRatesHz[i % (sizeof(kRatesHz) / sizeof(kRatesHz[0]))];
+            intervals[i] = std::chrono::nanoseconds(1000000000LL / hz);
+            timer.registerRecurrentEvent(intervals[i], i);
+        }
+
+        const int64_t cpuStart = cpuTimeNs();
+        std::this_thread::sleep_for(kRunTime);
+        const int64_t cpu = cpuTimeNs() - cpuStart;
+
+        for (size_t i = 0; i < events; i++) {
+            timer.unregisterRecurrentEvent(i);
+        }
+
+        state.counters["cpu%"] = 100.0 * cpu
+                / std::chrono::duration_cast<std::chrono::nanoseconds>(kRunTime).count();
+    }
+    loop.stop();
+
+    const double seconds = std::chrono::duration<double>(kRunTime).count();
+    state.counters["batches/s"] = batches / seconds;
+    state.counters["fired/s"] = fired / seconds;
+    state.counters["jitter_p50_us"] = jitter.percentile(0.5) / 1000.0;
+    state.counters["jitter_p99_us"] = jitter.percentile(0.99) / 1000.0;
+    state.counters["jitter_max_us"] = jitter.max() / 1000.0;
+}
+
+static void timerArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgName("events")->Arg(8)->Arg(64)->Arg(256);
+    benchmark->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_RecurrentTimer, PropertyTimer)->Apply(timerArgs);
+BENCHMARK_TEMPLATE(BM_RecurrentTimer, TimerWheel)->Apply(timerArgs);
+
+/* subscribe()/unsubscribe() cost with range(0) other events registered. */
+template <typename Timer>
+static void BM_RecurrentTimerRegister(benchmark::State& state)
+{
+    EventLoop loop;
+    Timer timer(loop, [](const std::vector<int32_t>&) {});
+    for (int32_t i = 0; i < state.range(0); i++) {
+        timer.registerRecurrentEvent(std::chrono::seconds(1), i);
+    }
+
+    const int32_t cookie = state.range(0);
+    for (auto _ : state) {
+        timer.registerRecurrentEvent(std::chrono::milliseconds(100), cookie);
+        timer.unregisterRecurrentEvent(cookie);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_RecurrentTimerRegister, PropertyTimer)->ArgName("events")->Arg(8)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_RecurrentTimerRegister, TimerWheel)->ArgName("events")->Arg(8)->Arg(64)->Arg(256);
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include <linux/can/raw.h>
+
+#include <android-base/stringprintf.h>
+#include <utils/SystemClock.h>
+
+#include "VcanHarness.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static bool runIp(const std::string& arguments)
+{
+    return system(("ip link " + arguments + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+VcanHarness::VcanHarness(bool fd, VehicleHalConfig config) :
+    mCreated(false),
+    mEvents(0)
+{
+    if (if_nametoindex(kInterface) == 0) {
+        mCreated = runIp(android::base::StringPrintf("add dev %s type vcan", kInterface));
+    }
+    runIp(android::base::StringPrintf("set dev %s down", kInterface));
+    runIp(android::base::StringPrintf("set dev %s mtu %zu", kInterface, fd ? CANFD_MTU : CAN_MTU));
+    runIp(android::base::StringPrintf("set dev %s up", kInterface));
+
+    config.canInterfaces = {kInterface};
+    config.canFd = fd;
+    mHal = std::make_unique<VehicleHalImpl>(&mStore, config);
+    mHal->init(&mValuePool,
+               [this](VehicleHal::VehiclePropValuePtr value) { onHalEvent(std::move(value)); },
+               [](StatusCode, int32_t, int32_t) {});
+    mHal->onCreate();
+}
+
+VcanHarness::~VcanHarness(void)
+{
+    mHal.reset();
+
+    if (mCreated) {
+        runIp(android::base::StringPrintf("del dev %s", kInterface));
+    }
+}
+
+bool VcanHarness::isReady(void) const
+{
+    return mHal->canBusCount() != 0 && mHal->canBus(0).isOpen();
+}
+
+int VcanHarness::openPeerSocket(const std::vector<struct can_filter>& filters) const
+{
+    int sock = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (sock < 0) {
+        return -1;
+    }
+
+    const int enable = 1;
+    setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+    setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+               filters.size() * sizeof(struct can_filter));
+
+    struct sockaddr_can addr = {};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = if_nametoindex(kInterface);
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool VcanHarness::waitForEvents(uint64_t count, std::chrono::milliseconds timeout) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (mEvents < count) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    return true;
+}
+
+void VcanHarness::waitForIdle(std::chrono::milliseconds timeout) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    const CanBus::Stats& stats = busStats();
+    uint64_t received = stats.received;
+
+    // Settled: nothing new from the socket for a while and the dispatch thread caught up.
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        const uint64_t now = stats.received;
+        if (now == received && stats.accepted + stats.dropped + stats.backlogged >= now) {
+            return;
+        }
+        received = now;
+    }
+}
+
+LatencyHistogram VcanHarness::takeEventLatency(void)
+{
+    std::lock_guard<std::mutex> lock(mLatencyLock);
+    LatencyHistogram latency = mLatency;
+    mLatency = LatencyHistogram();
+    return latency;
+}
+
+void VcanHarness::onHalEvent(VehicleHal::VehiclePropValuePtr value)
+{
+    const int64_t latency = elapsedRealtimeNano() - value->timestamp;
+    {
+        std::lock_guard<std::mutex> lock(mLatencyLock);
+        mLatency.record(latency);
+    }
+    mEvents++;
+}
+
+static int64_t cpuTimeNs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t processCpuTimeNs(void)
+{
+    return cpuTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+int64_t threadCpuTimeNs(void)
+{
+    return cpuTimeNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
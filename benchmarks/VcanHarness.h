@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _VcanHarness_H_
+#define _VcanHarness_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <linux/can.h>
+
+#include <vhal_v2_0/VehicleObjectPool.h>
+
+#include "LatencyStats.h"
+#include "VehicleHalImpl.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/**
+ * A virtual CAN interface with a VehicleHalImpl listening on it, for
+ * benchmarks that drive the HAL from the bus side. Creating the interface
+ * needs root and the vcan kernel module.
+ */
+class VcanHarness {
+public:
+    static constexpr const char* kInterface = "vhalbench0";
+
+    /* fd selects a CAN FD capable interface (MTU 72). */
+    explicit VcanHarness(bool fd = false, VehicleHalConfig config = VehicleHalConfig());
+    ~VcanHarness(void);
+
+    /* The interface is up and the HAL opened it. */
+    bool isReady(void) const;
+
+    /* A raw socket on the interface for the peer side, -1 on failure. */
+    int openPeerSocket(const std::vector<struct can_filter>& filters) const;
+
+    VehicleHalImpl& hal(void) { return *mHal; }
+    const CanBus::Stats& busStats(void) const { return mHal->canBus(0).stats(); }
+
+    uint64_t events(void) const { return mEvents; }
+    /* Waits until at least count events were emitted since construction. */
+    bool waitForEvents(uint64_t count, std::chrono::milliseconds timeout) const;
+    /* Waits until the HAL has taken every frame it is going to get off the socket. */
+    void waitForIdle(std::chrono::milliseconds timeout) const;
+
+    /* Frame RX timestamp to event delivery, reset by the call. */
+    LatencyHistogram takeEventLatency(void);
+
+private:
+    void onHalEvent(VehicleHal::VehiclePropValuePtr value);
+
+    bool                            mCreated;   // interface created, and removed, by us
+    StaticPropertyStore             mStore;
+    VehiclePropValuePool            mValuePool;
+    std::unique_ptr<VehicleHalImpl> mHal;
+    std::atomic<uint64_t>           mEvents;
+    std::mutex                      mLatencyLock;
+    LatencyHistogram                mLatency;
+};
+
+/* CPU time of the whole process and of the calling thread, in nanoseconds. */
+int64_t processCpuTimeNs(void);
+int64_t threadCpuTimeNs(void);
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _VcanHarness_H_
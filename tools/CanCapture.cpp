@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "CanCapture.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static constexpr char kBinaryMagic[8] = {'V', 'H', 'A', 'L', 'C', 'A', 'N', '1'};
+static constexpr uint8_t kBinaryFdFlag = 0x01;
+
+/* Binary record header, followed by len data bytes. */
+struct __attribute__((packed)) BinaryRecord {
+    int64_t     timestamp;
+    uint32_t    canId;
+    uint8_t     len;
+    uint8_t     flags;      // kBinaryFdFlag
+    uint8_t     fdFlags;    // canfd_frame::flags
+    uint8_t     reserved;
+};
+
+static_assert(sizeof(BinaryRecord) == 16, "BinaryRecord must stay 16 bytes");
+
+CaptureWriter::CaptureWriter(const std::string& path, CaptureFormat format,
+                             const std::string& interface) :
+    mFile(fopen(path.c_str(), "we")),
+    mFormat(format),
+    mInterface(interface)
+{
+    if (mFile != nullptr && mFormat == CaptureFormat::BINARY) {
+        fwrite(kBinaryMagic, sizeof(kBinaryMagic), 1, mFile);
+    }
+}
+
+CaptureWriter::~CaptureWriter(void)
+{
+    if (mFile != nullptr) {
+        fclose(mFile);
+    }
+}
+
+bool CaptureWriter::write(const CapturedFrame& captured)
+{
+    const struct canfd_frame& frame = captured.frame;
+
+    if (mFormat == CaptureFormat::BINARY) {
+        const BinaryRecord record = {
+            .timestamp = captured.timestamp,
+            .canId = frame.can_id,
+            .len = frame.len,
+            .flags = static_cast<uint8_t>(captured.fd ? kBinaryFdFlag : 0),
+            .fdFlags = frame.flags,
+            .reserved = 0,
+        };
+        return fwrite(&record, sizeof(record), 1, mFile) == 1
+                && fwrite(frame.data, 1, frame.len, mFile) == frame.len;
+    }
+
+    // (seconds.micros) interface ID#DATA, ID##<flags>DATA for CAN FD, ID#R for RTR.
+    char line[256];
+    int length = snprintf(line, sizeof(line), "(%" PRId64 ".%06" PRId64 ") %s ",
+                          captured.timestamp / 1000000000, (captured.timestamp / 1000) % 1000000,
+                          mInterface.c_str());
+    if (frame.can_id & CAN_EFF_FLAG) {
+        length += snprintf(line + length, sizeof(line) - length, "%08X", frame.can_id & CAN_EFF_MASK);
+    } else {
+        length += snprintf(line + length, sizeof(line) - length, "%03X", frame.can_id & CAN_SFF_MASK);
+    }
+
+    if (captured.fd) {
+        length += snprintf(line + length, sizeof(line) - length, "##%X", frame.flags & 0xf);
+    } else if (frame.can_id & CAN_RTR_FLAG) {
+        length += snprintf(line + length, sizeof(line) - length, "#R");
+    } else {
+        length += snprintf(line + length, sizeof(line) - length, "#");
+    }
+    if (!(frame.can_id & CAN_RTR_FLAG)) {
+        for (size_t i = 0; i < frame.len; i++) {
+            length += snprintf(line + length, sizeof(line) - length, "%02X", frame.data[i]);
+        }
+    }
+
+    return fprintf(mFile, "%s\n", line) > 0;
+}
+
+CaptureReader::CaptureReader(const std::string& path) :
+    mFile(fopen(path.c_str(), "re")),
+    mFormat(CaptureFormat::CANDUMP)
+{
+    rewind();
+}
+
+CaptureReader::~CaptureReader(void)
+{
+    if (mFile != nullptr) {
+        fclose(mFile);
+    }
+}
+
+void CaptureReader::rewind(void)
+{
+    if (mFile == nullptr) {
+        return;
+    }
+
+    char magic[sizeof(kBinaryMagic)];
+    fseek(mFile, 0, SEEK_SET);
+    if (fread(magic, sizeof(magic), 1, mFile) == 1 && memcmp(magic, kBinaryMagic, sizeof(magic)) == 0) {
+        mFormat = CaptureFormat::BINARY;
+    } else {
+        mFormat = CaptureFormat::CANDUMP;
+        fseek(mFile, 0, SEEK_SET);
+    }
+}
+
+bool CaptureReader::read(CapturedFrame* frame)
+{
+    if (mFile == nullptr) {
+        return false;
+    }
+    return (mFormat == CaptureFormat::BINARY) ? readBinary(frame) : readCandump(frame);
+}
+
+bool CaptureReader::readBinary(CapturedFrame* captured)
+{
+    BinaryRecord record;
+    if (fread(&record, sizeof(record), 1, mFile) != 1 || record.len > CANFD_MAX_DLEN) {
+        return false;
+    }
+
+    std::memset(captured, 0, sizeof(*captured));
+    captured->timestamp = record.timestamp;
+    captured->fd = (record.flags & kBinaryFdFlag) != 0;
+    captured->frame.can_id = record.canId;
+    captured->frame.len = record.len;
+    captured->frame.flags = record.fdFlags;
+    return fread(captured->frame.data, 1, record.len, mFile) == record.len;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+bool CaptureReader::readCandump(CapturedFrame* captured)
+{
+    char line[512];
+
+    while (fgets(line, sizeof(line), mFile) != nullptr) {
+        int64_t seconds;
+        int64_t micros;
+        char interface[32];
+        char payload[300];
+        if (sscanf(line, "(%" SCNd64 ".%" SCNd64 ") %31s %299s", &seconds, &micros, interface,
+                   payload) != 4) {
+            continue;
+        }
+
+        const char* hash = strchr(payload, '#');
+        if (hash == nullptr || (hash - payload != 3 && hash - payload != 8)) {
+            continue;
+        }
+
+        std::memset(captured, 0, sizeof(*captured));
+        captured->timestamp = seconds * 1000000000 + micros * 1000;
+        captured->frame.can_id = strtoul(std::string(payload, hash - payload).c_str(), nullptr, 16);
+        if (hash - payload == 8) {
+            captured->frame.can_id |= CAN_EFF_FLAG;
+        }
+
+        const char* data = hash + 1;
+        if (*data == '#') {
+            captured->fd = true;
+            if (hexValue(data[1]) < 0) {
+                continue;
+            }
+            captured->frame.flags = hexValue(data[1]);
+            data += 2;
+        } else if (*data == 'R') {
+            captured->frame.can_id |= CAN_RTR_FLAG;
+            return true;
+        }
+
+        const size_t maxLength = captured->fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+        size_t length = 0;
+        bool valid = true;
+        for (; data[0] != '\0' && data[0] != '\n'; data += 2) {
+            const int high = hexValue(data[0]);
+            const int low = hexValue(data[1]);
+            if (high < 0 || low < 0 || length == maxLength) {
+                valid = false;
+                break;
+            }
+            captured->frame.data[length++] = static_cast<uint8_t>(high << 4 | low);
+        }
+        if (!valid) {
+            continue;
+        }
+        captured->frame.len = length;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
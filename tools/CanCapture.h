@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CanCapture_H_
+#define _CanCapture_H_
+
+#include <cstdio>
+#include <string>
+
+#include <inttypes.h>
+
+#include <linux/can.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+struct CapturedFrame {
+    int64_t             timestamp;  // ns, CLOCK_REALTIME of the capture
+    bool                fd;
+    struct canfd_frame  frame;
+};
+
+enum class CaptureFormat {
+    CANDUMP,    // candump -l text log, readable by can-utils
+    BINARY,     // fixed 16 byte header per frame followed by its data
+};
+
+/*
+ * Capture file writer and reader. Readers detect the format from the file
+ * contents, so replays take logs of either kind.
+ */
+class CaptureWriter {
+public:
+    CaptureWriter(const std::string& path, CaptureFormat format, const std::string& interface);
+    ~CaptureWriter(void);
+
+    bool isOpen(void) const { return mFile != nullptr; }
+    bool write(const CapturedFrame& frame);
+
+private:
+    FILE*               mFile;
+    const CaptureFormat mFormat;
+    const std::string   mInterface;
+};
+
+class CaptureReader {
+public:
+    explicit CaptureReader(const std::string& path);
+    ~CaptureReader(void);
+
+    bool isOpen(void) const { return mFile != nullptr; }
+    /* Next frame of the file, false at its end. Malformed candump lines are skipped. */
+    bool read(CapturedFrame* frame);
+    /* Starts over, for looped replays. */
+    void rewind(void);
+
+private:
+    bool readBinary(CapturedFrame* frame);
+    bool readCandump(CapturedFrame* frame);
+
+    FILE*               mFile;
+    CaptureFormat       mFormat;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _CanCapture_H_
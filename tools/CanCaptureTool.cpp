@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Records CAN traffic and replays it with its original timing:
+ *
+ *   vhal_can_capture record -i can0 -o drive.log [-b] [-d seconds]
+ *   vhal_can_capture replay -i vcan0 -r drive.log [-s speed] [-l loops]
+ *
+ * record writes a candump -l compatible log, or the compact binary format
+ * with -b. replay takes either, at 1x by default, Nx with -s N, or as fast
+ * as the interface accepts with -s 0.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "CanCapture.h"
+#include "CanSocket.h"
+
+using namespace android::hardware::automotive::vehicle::V2_0::renesas;
+
+static std::atomic<bool> gStop(false);
+
+static void onSignal(int)
+{
+    gStop = true;
+}
+
+static int64_t realtimeNs(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static int record(const std::string& interface, const std::string& path, CaptureFormat format,
+                  int durationSec)
+{
+    int sock = openCanSocket(interface);
+    if (sock < 0) {
+        return 1;
+    }
+    const int enable = 1;
+    setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+
+    CaptureWriter writer(path, format, interface);
+    if (!writer.isOpen()) {
+        fprintf(stderr, "Could not create %s: %s\n", path.c_str(), strerror(errno));
+        close(sock);
+        return 1;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(durationSec);
+    uint64_t frames = 0;
+
+    while (!gStop && (durationSec == 0 || std::chrono::steady_clock::now() < deadline)) {
+        struct pollfd pfd = {.fd = sock, .events = POLLIN, .revents = 0};
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+
+        CapturedFrame captured = {};
+        struct iovec iov = {.iov_base = &captured.frame, .iov_len = sizeof(captured.frame)};
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        const ssize_t length = recvmsg(sock, &msg, MSG_DONTWAIT);
+        if (length != CAN_MTU && length != CANFD_MTU) {
+            continue;
+        }
+
+        captured.fd = (length == CANFD_MTU);
+        captured.timestamp = realtimeNs();
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+                struct timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                captured.timestamp = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+            }
+        }
+
+        if (!writer.write(captured)) {
+            fprintf(stderr, "Write to %s failed\n", path.c_str());
+            break;
+        }
+        frames++;
+    }
+
+    fprintf(stderr, "Recorded %" PRIu64 " frames\n", frames);
+    close(sock);
+    return 0;
+}
+
+static int replay(const std::string& interface, const std::string& path, double speed, int loops)
+{
+    // The last stretch before a frame is due is spun, not slept, so bursts keep their spacing.
+    static constexpr auto kSpinWindow = std::chrono::microseconds(100);
+    static constexpr auto kLateThreshold = std::chrono::milliseconds(1);
+
+    int sock = openCanSocket(interface);
+    if (sock < 0) {
+        return 1;
+    }
+
+    CaptureReader reader(path);
+    if (!reader.isOpen()) {
+        fprintf(stderr, "Could not open %s: %s\n", path.c_str(), strerror(errno));
+        close(sock);
+        return 1;
+    }
+
+    uint64_t frames = 0;
+    uint64_t retries = 0;
+    uint64_t late = 0;
+    std::chrono::nanoseconds maxLateness(0);
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int loop = 0; (loops == 0 || loop < loops) && !gStop; loop++) {
+        reader.rewind();
+
+        CapturedFrame captured;
+        int64_t first = -1;
+        const auto loopStart = std::chrono::steady_clock::now();
+
+        while (!gStop && reader.read(&captured)) {
+            if (first < 0) {
+                first = captured.timestamp;
+            }
+
+            if (speed > 0) {
+                const auto due = loopStart + std::chrono::nanoseconds(
+                        static_cast<int64_t>((captured.timestamp - first) / speed));
+                std::this_thread::sleep_until(due - kSpinWindow);
+                auto now = std::chrono::steady_clock::now();
+                while (now < due) {
+                    now = std::chrono::steady_clock::now();
+                }
+                if (now - due > kLateThreshold) {
+                    late++;
+                }
+                maxLateness = std::max<std::chrono::nanoseconds>(maxLateness, now - due);
+            }
+
+            if (!sendCanFrame(sock, captured.frame, captured.fd ? CANFD_MTU : CAN_MTU, &retries)) {
+                fprintf(stderr, "Send failed: %s\n", strerror(errno));
+                close(sock);
+                return 1;
+            }
+            frames++;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    fprintf(stderr, "Replayed %" PRIu64 " frames in %.3f s (%.0f frames/s), send retries %" PRIu64
+            ", late > 1 ms %" PRIu64 ", max lateness %.1f us\n",
+            frames, seconds, (seconds > 0) ? frames / seconds : 0.0, retries, late,
+            maxLateness.count() / 1000.0);
+    close(sock);
+    return 0;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s record -i <interface> -o <file> [-b] [-d <seconds>]\n"
+            "       %s replay -i <interface> -r <file> [-s <speed, 0 - max>] [-l <loops, 0 - forever>]\n",
+            name, name);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    const std::string command = argv[1];
+
+    std::string interface;
+    std::string path;
+    CaptureFormat format = CaptureFormat::CANDUMP;
+    int duration = 0;
+    double speed = 1.0;
+    int loops = 1;
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "i:o:r:bd:s:l:")) != -1) {
+        switch (opt) {
+            case 'i': interface = optarg; break;
+            case 'o':
+            case 'r': path = optarg; break;
+            case 'b': format = CaptureFormat::BINARY; break;
+            case 'd': duration = atoi(optarg); break;
+            case 's': speed = atof(optarg); break;
+            case 'l': loops = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (interface.empty() || path.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    if (command == "record") {
+        return record(interface, path, format, duration);
+    }
+    if (command == "replay") {
+        return replay(interface, path, speed, loops);
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <errno.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <linux/can/raw.h>
+
+#include "CanSocket.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+int openCanSocket(const std::string& interface)
+{
+    int sock = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (sock < 0) {
+        fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    const int enable = 1;
+    setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+
+    struct sockaddr_can addr = {};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = if_nametoindex(interface.c_str());
+    if (addr.can_ifindex == 0
+            || bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        fprintf(stderr, "Could not bind to %s: %s\n", interface.c_str(), strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool isCanFdInterface(int sock, const std::string& interface)
+{
+    struct ifreq ifr = {};
+    strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    return ioctl(sock, SIOCGIFMTU, &ifr) == 0 && ifr.ifr_mtu == CANFD_MTU;
+}
+
+bool sendCanFrame(int sock, const struct canfd_frame& frame, size_t mtu, uint64_t* retries,
+                  uint64_t maxRetries)
+{
+    for (uint64_t attempt = 0; write(sock, &frame, mtu) < 0; attempt++) {
+        if ((errno != ENOBUFS && errno != EAGAIN) || attempt == maxRetries) {
+            return false;
+        }
+        (*retries)++;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
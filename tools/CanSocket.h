@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CanSocket_H_
+#define _CanSocket_H_
+
+#include <string>
+
+#include <inttypes.h>
+
+#include <linux/can.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/* Raw socket bound to interface, taking CAN FD frames too. -1 on failure, reported on stderr. */
+int openCanSocket(const std::string& interface);
+
+/* The interface was configured with "fd on" (MTU 72). */
+bool isCanFdInterface(int sock, const std::string& interface);
+
+/*
+ * Writes one frame, retrying while the interface queue is full. Returns
+ * false on other errors, or when the queue stays full for maxRetries.
+ */
+bool sendCanFrame(int sock, const struct canfd_frame& frame, size_t mtu, uint64_t* retries,
+                  uint64_t maxRetries = UINT64_MAX);
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _CanSocket_H_
@@ -0,0 +1,872 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The vehicle side of the HAL's CAN buses, for tests without hardware:
+ *
+ *   vhal_ecu_simulator -i vcan0[,vcan1,vcan2] [-x <rate factor>] [-d <seconds>]
+ *                      [-p <prop>[@<area>]=<profile>]...
+ *
+ * Interfaces are given in the order of ro.vendor.vehicle.can.interfaces.
+ * Every property of kVehicleProperties is sent the way the HAL expects it
+ * (signal messages of DefaultCanConfig.h, VHAL messages or ISO-TP, see
+ * CanProtocol.h), following the profiles of SignalProfile.h: continuous
+ * properties at their maximum sample rate, on-change ones every 100 ms,
+ * static ones once. -x multiplies all rates, for scaling tests.
+ *
+ * Values the HAL sends from set() are taken over and held, and the new
+ * state is sent back at once, as the ECU owning the signal would do.
+ *
+ * -p replaces the profile of a property, e.g. -p 0x11600207=sine:0:50:20;
+ * see parseProfile() for the profile syntax.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "CanProtocol.h"
+#include "CanSocket.h"
+#include "DefaultCanConfig.h"
+#include "DefaultConfig.h"
+#include "IsoTp.h"
+#include "SignalProfile.h"
+
+static std::atomic<bool> gStop(false);
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr auto kOnChangePeriod = std::chrono::milliseconds(100);
+static constexpr auto kDefaultContinuousPeriod = std::chrono::milliseconds(100);
+static constexpr auto kStatsInterval = std::chrono::seconds(1);
+static constexpr size_t kIsoTpMaxQueued = 16;
+static constexpr uint64_t kMaxSendRetries = 1000;
+static constexpr size_t kMaxFramesPerRead = 64;
+static constexpr size_t kNoChannel = SIZE_MAX;
+
+static float getPhysicalValue(const VehiclePropValue& propValue)
+{
+    if (getPropType(propValue.prop) == VehiclePropertyType::FLOAT) {
+        return (propValue.value.floatValues.size() != 0) ? propValue.value.floatValues[0] : 0.0f;
+    }
+    return (propValue.value.int32Values.size() != 0) ? propValue.value.int32Values[0] : 0;
+}
+
+static void setPhysicalValue(VehiclePropValue* propValue, float value)
+{
+    if (getPropType(propValue->prop) == VehiclePropertyType::FLOAT) {
+        propValue->value.floatValues.resize(1);
+        propValue->value.floatValues[0] = value;
+    } else {
+        propValue->value.int32Values.resize(1);
+        propValue->value.int32Values[0] = static_cast<int32_t>(std::lround(value));
+    }
+}
+
+static bool isScalarValue(const VehiclePropValue::RawValue& value)
+{
+    return value.int32Values.size() + value.floatValues.size() == 1
+            && value.int64Values.size() == 0 && value.bytes.size() == 0
+            && value.stringValue.size() == 0;
+}
+
+static bool isEmptyValue(const VehiclePropValue::RawValue& value)
+{
+    return value.int32Values.size() == 0 && value.floatValues.size() == 0
+            && value.int64Values.size() == 0 && value.bytes.size() == 0
+            && value.stringValue.size() == 0;
+}
+
+struct ProfileOverride {
+    int32_t         prop;
+    int32_t         areaId;
+    bool            allAreas;
+    SignalProfile   profile;
+};
+
+class EcuSimulator {
+public:
+    explicit EcuSimulator(double rateFactor);
+    ~EcuSimulator(void);
+
+    bool open(const std::vector<std::string>& interfaces);
+    void build(const std::vector<ProfileOverride>& overrides);
+    void run(std::chrono::seconds duration);
+
+private:
+    /* One (property, area) and its current value. */
+    struct Channel {
+        VehiclePropValue                    value;
+        size_t                              areaIndex;  // classic VHAL messages, CanProtocol.h
+        bool                                writable;
+        size_t                              stream;
+        std::unique_ptr<SignalGenerator>    generator;  // scalars only
+    };
+
+    enum class StreamKind {
+        SIGNALS,    // one signal message of kCanMessages
+        VHAL,       // VHAL messages of all areas of one property
+        ISOTP,      // ISO-TP messages of all areas of one property
+    };
+
+    /* What is sent together, every period (0 - once, and in reply to set()). */
+    struct Stream {
+        StreamKind                  kind;
+        const CanMessage*           message;    // SIGNALS
+        std::vector<size_t>         channels;   // SIGNALS: one per signal, kNoChannel if unknown
+        size_t                      bus;
+        std::chrono::nanoseconds    period;
+    };
+
+    struct Bus {
+        std::string name;
+        int         sock;
+        bool        fd;
+    };
+
+    struct Stats {
+        uint64_t    sent = 0;
+        uint64_t    retries = 0;
+        uint64_t    dropped = 0;
+        uint64_t    received = 0;
+        uint64_t    sets = 0;
+        uint64_t    overruns = 0;   // streams that missed their period
+    };
+
+    size_t busFor(uint8_t route) const { return (route < mBuses.size()) ? route : 0; }
+    size_t findChannel(int32_t prop, int32_t areaId) const;
+    std::chrono::nanoseconds periodOf(const VehiclePropConfig& config) const;
+
+    void update(const Stream& stream, double t);
+    void transmit(const Stream& stream);
+    void transmitSignals(const Stream& stream);
+    void transmitVhal(const Stream& stream);
+    void queueIsoTp(const Channel& channel);
+    bool sendFrame(size_t bus, canid_t canId, const void* data, size_t length, bool fd);
+    void pumpIsoTp(void);
+
+    void receive(const Bus& bus);
+    void onFrame(const struct canfd_frame& frame, size_t mtu);
+    void onVhalFrame(const struct canfd_frame& frame, size_t mtu);
+    void onSignalFrame(const struct canfd_frame& frame);
+    void onIsoTpMessage(const uint8_t* message, size_t length);
+    void accept(size_t channel, float value);
+
+    void printStats(double seconds);
+
+    const double                        mRateFactor;
+    std::vector<Bus>                    mBuses;
+    std::vector<Channel>                mChannels;
+    std::map<std::pair<int32_t, int32_t>, size_t> mChannelIndex;
+    std::map<int32_t, std::vector<int32_t>> mAreaIds;   // areas in declaration order, classic CAN
+    std::vector<Stream>                 mStreams;
+    std::vector<size_t>                 mAnswers;       // streams to send back after set()
+    DriveCycle                          mCycle;
+    Stats                               mStats;
+    Stats                               mLastStats;
+
+    IsoTpSender                         mIsoTpSender;
+    IsoTpReceiver                       mIsoTpReceiver;
+    std::deque<std::vector<uint8_t>>    mIsoTpQueue;
+    Clock::time_point                   mIsoTpNextPoll;
+};
+
+EcuSimulator::EcuSimulator(double rateFactor) :
+    mRateFactor(rateFactor),
+    mIsoTpSender(kVhalIsoTpMaxMessageSize, [this](const uint8_t* data, size_t length) {
+        const size_t bus = busFor(kCanIsoTpBus);
+        return sendFrame(bus, kCanIsoTpRxId, data, length, mBuses[bus].fd);
+    }),
+    mIsoTpReceiver(kVhalIsoTpMaxMessageSize, 0, 0, [this](const uint8_t* data, size_t length) {
+        const size_t bus = busFor(kCanIsoTpBus);
+        return sendFrame(bus, kCanIsoTpRxId, data, length, mBuses[bus].fd);
+    }),
+    mIsoTpNextPoll(Clock::time_point::max())
+{
+}
+
+EcuSimulator::~EcuSimulator(void)
+{
+    for (auto& bus : mBuses) {
+        close(bus.sock);
+    }
+}
+
+bool EcuSimulator::open(const std::vector<std::string>& interfaces)
+{
+    for (auto& name : interfaces) {
+        int sock = openCanSocket(name);
+        if (sock < 0) {
+            return false;
+        }
+        mBuses.push_back({name, sock, isCanFdInterface(sock, name)});
+        fprintf(stderr, "%s: %s\n", name.c_str(), mBuses.back().fd ? "CAN FD" : "classic CAN");
+    }
+    return !mBuses.empty();
+}
+
+size_t EcuSimulator::findChannel(int32_t prop, int32_t areaId) const
+{
+    auto it = mChannelIndex.find({prop, areaId});
+    return (it != mChannelIndex.end()) ? it->second : kNoChannel;
+}
+
+std::chrono::nanoseconds EcuSimulator::periodOf(const VehiclePropConfig& config) const
+{
+    std::chrono::nanoseconds period(0);
+
+    if (config.changeMode == VehiclePropertyChangeMode::CONTINUOUS) {
+        period = (config.maxSampleRate > 0)
+                ? std::chrono::nanoseconds(static_cast<int64_t>(1e9 / config.maxSampleRate))
+                : kDefaultContinuousPeriod;
+    } else if (config.changeMode == VehiclePropertyChangeMode::ON_CHANGE) {
+        period = kOnChangePeriod;
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(period.count() / mRateFactor));
+}
+
+void EcuSimulator::build(const std::vector<ProfileOverride>& overrides)
+{
+    std::map<int32_t, size_t> streamOfProperty;
+
+    // The channels, with the same values and areas the HAL stores in onCreate().
+    for (auto& it : kVehicleProperties) {
+        const VehiclePropConfig& config = it.config;
+        if (mAreaIds.count(config.prop) != 0) {
+            continue;   // The first declaration wins, as in the HAL
+        }
+
+        std::vector<int32_t> areas;
+        if (isGlobalProp(config.prop)) {
+            areas.push_back(0);
+        } else {
+            for (auto& areaConfig : config.areaConfigs) {
+                areas.push_back(areaConfig.areaId);
+            }
+        }
+        mAreaIds[config.prop] = areas;
+        const int32_t lowestArea = areas.empty() ? 0 : *std::min_element(areas.begin(), areas.end());
+
+        for (size_t i = 0; i < areas.size(); i++) {
+            VehiclePropValue value = {.prop = config.prop, .areaId = areas[i]};
+            if (it.initialAreaValues.size() > 0) {
+                auto valueIt = it.initialAreaValues.find(areas[i]);
+                if (valueIt != it.initialAreaValues.end()) {
+                    value.value = valueIt->second;
+                }
+            } else {
+                value.value = it.initialValue;
+            }
+            if (isEmptyValue(value.value)) {
+                continue;   // Nothing the HAL could show
+            }
+
+            Channel channel = {
+                .value = value,
+                .areaIndex = (isGlobalProp(config.prop) || areas[i] == lowestArea) ? 0 : i + 1,
+                .writable = config.access != VehiclePropertyAccess::READ,
+                .stream = kNoChannel,
+            };
+
+            if (isScalarValue(value.value)) {
+                const float initial = getPhysicalValue(value);
+                SignalProfile profile = defaultProfile(config, areas[i], initial);
+                for (auto& entry : overrides) {
+                    if (entry.prop == config.prop && (entry.allAreas || entry.areaId == areas[i])) {
+                        profile = entry.profile;
+                    }
+                }
+                channel.generator = std::make_unique<SignalGenerator>(profile, initial,
+                                                                      config.prop ^ areas[i]);
+            }
+
+            mChannelIndex[{config.prop, areas[i]}] = mChannels.size();
+            mChannels.push_back(std::move(channel));
+        }
+    }
+
+    // Signal messages carry their properties, whatever else the HAL could take.
+    for (auto& message : kCanMessages) {
+        uint8_t route = kCanBusPowertrain;
+        for (auto& entry : kCanMessageRoutes) {
+            if (entry.canId == message.canId) {
+                route = entry.bus;
+            }
+        }
+
+        Stream stream = {StreamKind::SIGNALS, &message, {}, busFor(route), std::chrono::nanoseconds(0)};
+        const CanSignal* signals = &kCanSignals[message.firstSignal];
+        for (size_t i = 0; i < message.signalCount; i++) {
+            const size_t channel = findChannel(signals[i].prop, signals[i].areaId);
+            stream.channels.push_back(channel);
+            if (channel == kNoChannel) {
+                continue;
+            }
+            mChannels[channel].stream = mStreams.size();
+            streamOfProperty[signals[i].prop] = mStreams.size();
+
+            for (auto& it : kVehicleProperties) {
+                const auto period = periodOf(it.config);
+                if (it.config.prop == signals[i].prop && period.count() != 0
+                        && (stream.period.count() == 0 || period < stream.period)) {
+                    stream.period = period;
+                }
+            }
+        }
+        mStreams.push_back(std::move(stream));
+    }
+
+    for (auto& it : kVehicleProperties) {
+        const VehiclePropConfig& config = it.config;
+        if (streamOfProperty.count(config.prop) != 0) {
+            continue;
+        }
+
+        uint8_t route = kCanDefaultPropertyBus;
+        for (auto& entry : kCanPropertyRoutes) {
+            if (entry.prop == config.prop) {
+                route = entry.bus;
+            }
+        }
+
+        Stream stream = {StreamKind::VHAL, nullptr, {}, busFor(route), periodOf(config)};
+        for (int32_t areaId : mAreaIds[config.prop]) {
+            const size_t channel = findChannel(config.prop, areaId);
+            if (channel == kNoChannel) {
+                continue;
+            }
+
+            // The same choice the HAL makes in set(), except that everything goes at once.
+            const VehiclePropValue& value = mChannels[channel].value;
+            vhal_canfd_msg_t msg;
+            const bool fits = mBuses[stream.bus].fd ? encodeCanFdMessage(value, &msg) != 0
+                                                    : isScalarValue(value.value)
+                                                      && mChannels[channel].areaIndex <= kCanVhalMaxAreaIndex;
+            if (!fits) {
+                stream.kind = StreamKind::ISOTP;
+                stream.bus = busFor(kCanIsoTpBus);
+                stream.period = std::chrono::nanoseconds(0);
+            }
+            stream.channels.push_back(channel);
+            mChannels[channel].stream = mStreams.size();
+        }
+
+        if (!stream.channels.empty()) {
+            streamOfProperty[config.prop] = mStreams.size();
+            mStreams.push_back(std::move(stream));
+        }
+    }
+
+    double framesPerSecond = 0;
+    for (auto& stream : mStreams) {
+        if (stream.period.count() != 0) {
+            const size_t frames = (stream.kind == StreamKind::SIGNALS) ? 1 : stream.channels.size();
+            framesPerSecond += frames * 1e9 / stream.period.count();
+        }
+    }
+    fprintf(stderr, "%zu channels in %zu streams, about %.0f frames/s\n",
+            mChannels.size(), mStreams.size(), framesPerSecond);
+}
+
+void EcuSimulator::update(const Stream& stream, double t)
+{
+    for (size_t channel : stream.channels) {
+        if (channel != kNoChannel && mChannels[channel].generator != nullptr) {
+            setPhysicalValue(&mChannels[channel].value, mChannels[channel].generator->next(t, mCycle));
+        }
+    }
+}
+
+void EcuSimulator::transmit(const Stream& stream)
+{
+    switch (stream.kind) {
+        case StreamKind::SIGNALS:
+            transmitSignals(stream);
+            break;
+        case StreamKind::VHAL:
+            transmitVhal(stream);
+            break;
+        case StreamKind::ISOTP:
+            for (size_t channel : stream.channels) {
+                queueIsoTp(mChannels[channel]);
+            }
+            break;
+    }
+}
+
+void EcuSimulator::transmitSignals(const Stream& stream)
+{
+    uint8_t data[CAN_MAX_DLEN] = {};
+    const CanSignal* signals = &kCanSignals[stream.message->firstSignal];
+
+    for (size_t i = 0; i < stream.channels.size(); i++) {
+        const size_t channel = stream.channels[i];
+        encodeCanSignal(signals[i], (channel != kNoChannel) ? getPhysicalValue(mChannels[channel].value) : 0.0f,
+                        data);
+    }
+    sendFrame(stream.bus, stream.message->canId, data, stream.message->dlc, false);
+}
+
+void EcuSimulator::transmitVhal(const Stream& stream)
+{
+    const int32_t prop = mChannels[stream.channels[0]].value.prop;
+
+    if (!mBuses[stream.bus].fd) {
+        for (size_t channel : stream.channels) {
+            const vhal_can_msg_t msg = {prop, static_cast<int32_t>(getPhysicalValue(mChannels[channel].value))};
+            sendFrame(stream.bus, canIdForProperty(prop, mChannels[channel].areaIndex), &msg, sizeof(msg),
+                      false);
+        }
+        return;
+    }
+
+    // All areas of a scalar property fit into one area message.
+    const bool isFloat = getPropType(prop) == VehiclePropertyType::FLOAT;
+    bool scalar = stream.channels.size() > 1 && stream.channels.size() <= kVhalCanFdMaxAreas;
+    for (size_t channel : stream.channels) {
+        scalar = scalar && isScalarValue(mChannels[channel].value.value);
+    }
+
+    vhal_canfd_msg_t msg;
+    if (scalar) {
+        vhal_canfd_area_value_t values[kVhalCanFdMaxAreas];
+        for (size_t i = 0; i < stream.channels.size(); i++) {
+            const VehiclePropValue& value = mChannels[stream.channels[i]].value;
+            values[i].areaId = value.areaId;
+            if (isFloat) {
+                values[i].floatValue = getPhysicalValue(value);
+            } else {
+                values[i].int32Value = static_cast<int32_t>(getPhysicalValue(value));
+            }
+        }
+        const size_t length = encodeCanFdAreas(prop, isFloat, values, stream.channels.size(), &msg);
+        sendFrame(stream.bus, canIdForProperty(prop), &msg, length, true);
+        return;
+    }
+
+    for (size_t channel : stream.channels) {
+        const size_t length = encodeCanFdMessage(mChannels[channel].value, &msg);
+        sendFrame(stream.bus, canIdForProperty(prop), &msg, length, true);
+    }
+}
+
+void EcuSimulator::queueIsoTp(const Channel& channel)
+{
+    if (mIsoTpQueue.size() >= kIsoTpMaxQueued) {
+        mStats.dropped++;
+        return;
+    }
+
+    std::vector<uint8_t> message(kVhalIsoTpMaxMessageSize);
+    const size_t length = encodeIsoTpMessage(channel.value, message.data(), message.size());
+    if (length == 0) {
+        fprintf(stderr, "Prop 0x%x area 0x%x does not fit into an ISO-TP message\n",
+                channel.value.prop, channel.value.areaId);
+        return;
+    }
+    message.resize(length);
+    mIsoTpQueue.push_back(std::move(message));
+    mIsoTpNextPoll = Clock::now();
+}
+
+void EcuSimulator::pumpIsoTp(void)
+{
+    if (mIsoTpSender.isIdle() && !mIsoTpQueue.empty()) {
+        const std::vector<uint8_t>& message = mIsoTpQueue.front();
+        const bool fd = mBuses[busFor(kCanIsoTpBus)].fd;
+        mIsoTpSender.start(message.data(), message.size(), fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN);
+        mIsoTpQueue.pop_front();
+    }
+
+    const std::chrono::nanoseconds delay = mIsoTpSender.poll();
+    if (delay.count() != 0) {
+        mIsoTpNextPoll = Clock::now() + delay;
+    } else {
+        // Idle with more to send, or waiting for flow control, which calls back in.
+        mIsoTpNextPoll = (mIsoTpSender.isIdle() && !mIsoTpQueue.empty()) ? Clock::now()
+                                                                          : Clock::time_point::max();
+    }
+}
+
+bool EcuSimulator::sendFrame(size_t bus, canid_t canId, const void* data, size_t length, bool fd)
+{
+    struct canfd_frame frame = {};
+    frame.can_id = canId;
+    frame.len = static_cast<uint8_t>(length);
+    std::memcpy(frame.data, data, length);
+
+    if (!sendCanFrame(mBuses[bus].sock, frame, fd ? CANFD_MTU : CAN_MTU, &mStats.retries, kMaxSendRetries)) {
+        mStats.dropped++;
+        return false;
+    }
+    mStats.sent++;
+    return true;
+}
+
+void EcuSimulator::receive(const Bus& bus)
+{
+    for (size_t i = 0; i < kMaxFramesPerRead; i++) {
+        struct canfd_frame frame;
+        const ssize_t length = recv(bus.sock, &frame, sizeof(frame), MSG_DONTWAIT);
+        if (length != CAN_MTU && length != CANFD_MTU) {
+            return;
+        }
+        mStats.received++;
+        onFrame(frame, length);
+    }
+}
+
+void EcuSimulator::onFrame(const struct canfd_frame& frame, size_t mtu)
+{
+    if (frame.can_id == kCanIsoTpTxId) {
+        if (frame.len != 0 && isoTpPci(frame.data) == IsoTpPci::FLOW_CONTROL) {
+            mIsoTpSender.onFlowControl(frame.data, frame.len);
+            mIsoTpNextPoll = Clock::now();
+            return;
+        }
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now().time_since_epoch()).count();
+        if (mIsoTpReceiver.onFrame(frame.data, frame.len, now) == IsoTpReceiver::Result::COMPLETE) {
+            onIsoTpMessage(mIsoTpReceiver.message(), mIsoTpReceiver.messageLength());
+        }
+    } else if (isVhalCanId(frame.can_id)) {
+        onVhalFrame(frame, mtu);
+    } else if (!(frame.can_id & CAN_RTR_FLAG)) {
+        onSignalFrame(frame);
+    }
+}
+
+void EcuSimulator::onVhalFrame(const struct canfd_frame& frame, size_t mtu)
+{
+    if (mtu == CAN_MTU) {
+        vhal_can_msg_t msg;
+        if (frame.len < sizeof(msg)) {
+            return;
+        }
+        std::memcpy(&msg, frame.data, sizeof(msg));
+
+        auto areasIt = mAreaIds.find(msg.propId);
+        if (areasIt == mAreaIds.end()) {
+            return;
+        }
+        const size_t areaIndex = canIdAreaIndex(frame.can_id);
+        const auto& areas = areasIt->second;
+        int32_t areaId = areas.empty() ? 0 : *std::min_element(areas.begin(), areas.end());
+        if (isGlobalProp(msg.propId)) {
+            areaId = 0;
+        } else if (areaIndex != 0 && areaIndex <= areas.size()) {
+            areaId = areas[areaIndex - 1];
+        }
+        accept(findChannel(msg.propId, areaId), msg.propValue);
+        return;
+    }
+
+    vhal_canfd_msg_t msg = {};
+    std::memcpy(&msg, frame.data, frame.len);
+
+    if (isCanFdAreaMessage(msg)) {
+        vhal_canfd_area_value_t values[kVhalCanFdMaxAreas];
+        const size_t count = decodeCanFdAreas(msg, frame.len, values);
+        const bool isFloat = msg.valueType == static_cast<uint8_t>(VhalCanValueType::AREA_FLOAT);
+        for (size_t i = 0; i < count; i++) {
+            accept(findChannel(msg.propId, values[i].areaId),
+                   isFloat ? values[i].floatValue : values[i].int32Value);
+        }
+        return;
+    }
+
+    const size_t channel = findChannel(msg.propId, msg.areaId);
+    if (channel == kNoChannel) {
+        return;
+    }
+    VehiclePropValue value = mChannels[channel].value;
+    if (decodeCanFdMessage(msg, frame.len, &value)) {
+        mChannels[channel].value = value;
+        accept(channel, getPhysicalValue(value));
+    }
+}
+
+void EcuSimulator::onSignalFrame(const struct canfd_frame& frame)
+{
+    const CanMessage* message = findCanMessage(kCanMessages, frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK));
+    if (message == nullptr) {
+        return;
+    }
+
+    float values[kCanMaxSignalsPerMessage];
+    decodeCanMessage(*message, kCanSignals, frame.data, frame.len, values);
+
+    // The HAL repeats the other signals of the message, only writable ones are taken over.
+    const CanSignal* signals = &kCanSignals[message->firstSignal];
+    for (size_t i = 0; i < message->signalCount; i++) {
+        const size_t channel = findChannel(signals[i].prop, signals[i].areaId);
+        if (channel != kNoChannel && mChannels[channel].writable) {
+            accept(channel, values[i]);
+        }
+    }
+}
+
+void EcuSimulator::onIsoTpMessage(const uint8_t* message, size_t length)
+{
+    vhal_isotp_msg_hdr_t hdr;
+    if (length < sizeof(hdr)) {
+        return;
+    }
+    std::memcpy(&hdr, message, sizeof(hdr));
+
+    const size_t channel = findChannel(hdr.propId, hdr.areaId);
+    if (channel == kNoChannel) {
+        return;
+    }
+    VehiclePropValue value = mChannels[channel].value;
+    if (decodeIsoTpMessage(message, length, &value)) {
+        mChannels[channel].value = value;
+        accept(channel, isScalarValue(value.value) ? getPhysicalValue(value) : 0.0f);
+    }
+}
+
+void EcuSimulator::accept(size_t channel, float value)
+{
+    if (channel == kNoChannel) {
+        return;
+    }
+
+    Channel& target = mChannels[channel];
+    if (target.generator != nullptr) {
+        target.generator->hold(value);
+        setPhysicalValue(&target.value, value);
+    }
+    mStats.sets++;
+    if (target.stream != kNoChannel) {
+        mAnswers.push_back(target.stream);
+    }
+}
+
+void EcuSimulator::printStats(double seconds)
+{
+    fprintf(stderr, "tx %.0f frames/s, rx %.0f frames/s, sets %" PRIu64 ", ISO-TP %" PRIu64 "/%" PRIu64
+            " (sent/received), send retries %" PRIu64 ", dropped %" PRIu64 ", overruns %" PRIu64
+            ", speed %.1f km/h\n",
+            (mStats.sent - mLastStats.sent) / seconds, (mStats.received - mLastStats.received) / seconds,
+            mStats.sets, mIsoTpSender.stats().completed.load(), mIsoTpReceiver.stats().completed.load(),
+            mStats.retries, mStats.dropped, mStats.overruns, mCycle.speed() * 3.6);
+    mLastStats = mStats;
+}
+
+void EcuSimulator::run(std::chrono::seconds duration)
+{
+    using Due = std::pair<Clock::time_point, size_t>;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+
+    const auto start = Clock::now();
+    const auto end = (duration.count() != 0) ? start + duration : Clock::time_point::max();
+    auto lastStats = start;
+    double lastTime = 0;
+
+    // Spread the first frames over each period, so the streams do not all fire together.
+    for (size_t i = 0; i < mStreams.size(); i++) {
+        due.push({start + mStreams[i].period * (i % 16) / 16, i});
+    }
+
+    std::vector<struct pollfd> pfds;
+    for (auto& bus : mBuses) {
+        pfds.push_back({.fd = bus.sock, .events = POLLIN, .revents = 0});
+    }
+
+    while (!gStop) {
+        auto now = Clock::now();
+        if (now >= end) {
+            break;
+        }
+
+        const double t = std::chrono::duration<double>(now - start).count();
+        mCycle.advance(t - lastTime);
+        lastTime = t;
+
+        while (!due.empty() && due.top().first <= now) {
+            const auto [when, index] = due.top();
+            due.pop();
+
+            const Stream& stream = mStreams[index];
+            update(stream, t);
+            transmit(stream);
+
+            if (stream.period.count() != 0) {
+                auto next = when + stream.period;
+                if (next <= now) {
+                    mStats.overruns++;
+                    next = now + stream.period;
+                }
+                due.push({next, index});
+            }
+        }
+
+        for (size_t index : mAnswers) {
+            transmit(mStreams[index]);
+        }
+        mAnswers.clear();
+
+        if (mIsoTpNextPoll <= now) {
+            pumpIsoTp();
+        }
+
+        if (now - lastStats >= kStatsInterval) {
+            printStats(std::chrono::duration<double>(now - lastStats).count());
+            lastStats = now;
+        }
+
+        auto wake = std::min({end, lastStats + kStatsInterval, mIsoTpNextPoll});
+        if (!due.empty()) {
+            wake = std::min(wake, due.top().first);
+        }
+        const auto timeout = std::max(std::chrono::nanoseconds(0), wake - Clock::now());
+        const struct timespec ts = {
+            .tv_sec = static_cast<time_t>(timeout.count() / 1000000000),
+            .tv_nsec = static_cast<long>(timeout.count() % 1000000000),
+        };
+        if (ppoll(pfds.data(), pfds.size(), &ts, nullptr) <= 0) {
+            continue;
+        }
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (pfds[i].revents & POLLIN) {
+                receive(mBuses[i]);
+            }
+        }
+    }
+
+    printStats(std::chrono::duration<double>(Clock::now() - lastStats).count());
+}
+
+static bool parseOverride(const std::string& arg, ProfileOverride* entry)
+{
+    const size_t equals = arg.find('=');
+    if (equals == std::string::npos) {
+        return false;
+    }
+
+    char* end = nullptr;
+    entry->prop = static_cast<int32_t>(strtoul(arg.c_str(), &end, 0));
+    entry->allAreas = true;
+    entry->areaId = 0;
+    if (*end == '@') {
+        entry->allAreas = false;
+        entry->areaId = static_cast<int32_t>(strtoul(end + 1, &end, 0));
+    }
+    return end == arg.c_str() + equals && parseProfile(arg.substr(equals + 1), &entry->profile);
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+using namespace android::hardware::automotive::vehicle::V2_0::renesas;
+
+static void onSignal(int)
+{
+    gStop = true;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s -i <interface>[,<interface>...] [-x <rate factor>] [-d <seconds, 0 - forever>]\n"
+            "          [-p <prop>[@<area>]=<profile>]...\n"
+            "profiles: const:<v>, sine|ramp|square:<low>:<high>:<period s>, drift:<low>:<high>:<step/s>,\n"
+            "          speed, rpm, gear, gear_selection, parking_brake, odometer, fuel\n",
+            name);
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> interfaces;
+    std::vector<ProfileOverride> overrides;
+    double rateFactor = 1.0;
+    int duration = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:x:d:p:")) != -1) {
+        switch (opt) {
+            case 'i': {
+                std::string list = optarg;
+                for (size_t start = 0, comma; start <= list.size(); start = comma + 1) {
+                    comma = std::min(list.find(',', start), list.size());
+                    if (comma > start) {
+                        interfaces.push_back(list.substr(start, comma - start));
+                    }
+                }
+                break;
+            }
+            case 'x':
+                rateFactor = atof(optarg);
+                break;
+            case 'd':
+                duration = atoi(optarg);
+                break;
+            case 'p': {
+                ProfileOverride entry;
+                if (!parseOverride(optarg, &entry)) {
+                    fprintf(stderr, "Bad profile: %s\n", optarg);
+                    return 2;
+                }
+                overrides.push_back(entry);
+                break;
+            }
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (interfaces.empty() || rateFactor <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    EcuSimulator simulator(rateFactor);
+    if (!simulator.open(interfaces)) {
+        return 1;
+    }
+    simulator.build(overrides);
+    simulator.run(std::chrono::seconds(duration));
+    return 0;
+}
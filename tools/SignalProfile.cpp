@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <vhal_v2_0/VehicleUtils.h>
+
+#include "SignalProfile.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+static constexpr float kAcceleration = 2.5f;        // m/s^2
+static constexpr float kDeceleration = 3.0f;
+static constexpr float kMinCruiseSpeed = 10.0f;     // m/s
+static constexpr float kMaxCruiseSpeed = 33.0f;
+static constexpr double kParkedTime = 8.0;          // s
+static constexpr double kStoppedTime = 4.0;
+static constexpr double kMinCruiseTime = 20.0;
+static constexpr double kMaxCruiseTime = 60.0;
+static constexpr unsigned kLapsBetweenParking = 3;
+static constexpr double kMaxStep = 0.1;             // s, integration step
+
+static constexpr float kIdleRpm = 800.0f;
+static constexpr float kShiftSpeeds[] = {4.0f, 8.0f, 13.0f, 18.0f, 24.0f};       // m/s, upshift at
+static constexpr float kRpmPerSpeed[] = {750.0f, 375.0f, 230.0f, 167.0f, 125.0f, 90.0f};
+static constexpr VehicleGear kGears[] = {
+    VehicleGear::GEAR_1, VehicleGear::GEAR_2, VehicleGear::GEAR_3,
+    VehicleGear::GEAR_4, VehicleGear::GEAR_5, VehicleGear::GEAR_6,
+};
+static constexpr float kFuelPerKm = 70.0f;          // ml
+
+DriveCycle::DriveCycle(uint32_t seed) :
+    mRandom(seed),
+    mPhase(Phase::PARKED),
+    mPhaseLeft(kParkedTime),
+    mSpeed(0.0f),
+    mTargetSpeed(0.0f),
+    mDistance(0.0),
+    mLaps(0)
+{
+}
+
+void DriveCycle::enter(Phase phase)
+{
+    mPhase = phase;
+    switch (phase) {
+        case Phase::PARKED:
+            mPhaseLeft = kParkedTime;
+            break;
+        case Phase::STOPPED:
+            mPhaseLeft = kStoppedTime;
+            break;
+        case Phase::ACCELERATE:
+            mTargetSpeed = std::uniform_real_distribution<float>(kMinCruiseSpeed, kMaxCruiseSpeed)(mRandom);
+            break;
+        case Phase::CRUISE:
+            mPhaseLeft = std::uniform_real_distribution<double>(kMinCruiseTime, kMaxCruiseTime)(mRandom);
+            break;
+        case Phase::BRAKE:
+            break;
+    }
+}
+
+void DriveCycle::advance(double seconds)
+{
+    while (seconds > 0) {
+        const double dt = std::min(seconds, kMaxStep);
+        seconds -= dt;
+
+        switch (mPhase) {
+            case Phase::PARKED:
+            case Phase::STOPPED:
+            case Phase::CRUISE:
+                mPhaseLeft -= dt;
+                if (mPhaseLeft <= 0) {
+                    enter((mPhase == Phase::CRUISE) ? Phase::BRAKE : Phase::ACCELERATE);
+                }
+                break;
+            case Phase::ACCELERATE:
+                mSpeed = std::min(mTargetSpeed, static_cast<float>(mSpeed + kAcceleration * dt));
+                if (mSpeed >= mTargetSpeed) {
+                    enter(Phase::CRUISE);
+                }
+                break;
+            case Phase::BRAKE:
+                mSpeed = std::max(0.0f, static_cast<float>(mSpeed - kDeceleration * dt));
+                if (mSpeed == 0.0f) {
+                    mLaps++;
+                    enter((mLaps % kLapsBetweenParking == 0) ? Phase::PARKED : Phase::STOPPED);
+                }
+                break;
+        }
+        mDistance += mSpeed * dt;
+    }
+}
+
+static size_t gearIndex(float speed)
+{
+    return std::upper_bound(std::begin(kShiftSpeeds), std::end(kShiftSpeeds), speed)
+            - std::begin(kShiftSpeeds);
+}
+
+float DriveCycle::rpm(void) const
+{
+    return std::max(kIdleRpm, mSpeed * kRpmPerSpeed[gearIndex(mSpeed)]);
+}
+
+int32_t DriveCycle::gear(void) const
+{
+    return toInt(isParked() ? VehicleGear::GEAR_PARK : kGears[gearIndex(mSpeed)]);
+}
+
+int32_t DriveCycle::gearSelection(void) const
+{
+    return toInt(isParked() ? VehicleGear::GEAR_PARK : VehicleGear::GEAR_DRIVE);
+}
+
+static const VehicleAreaConfig* findAreaConfig(const VehiclePropConfig& config, int32_t areaId)
+{
+    for (auto& areaConfig : config.areaConfigs) {
+        if (areaConfig.areaId == areaId) {
+            return &areaConfig;
+        }
+    }
+    return nullptr;
+}
+
+SignalProfile defaultProfile(const VehiclePropConfig& config, int32_t areaId, float initial)
+{
+    switch (static_cast<VehicleProperty>(config.prop)) {
+        case VehicleProperty::PERF_VEHICLE_SPEED:
+            return {ProfileKind::SPEED, 0, 0, 0};
+        case VehicleProperty::ENGINE_RPM:
+            return {ProfileKind::RPM, 0, 0, 0};
+        case VehicleProperty::CURRENT_GEAR:
+            return {ProfileKind::GEAR, 0, 0, 0};
+        case VehicleProperty::GEAR_SELECTION:
+            return {ProfileKind::GEAR_SELECTION, 0, 0, 0};
+        case VehicleProperty::PARKING_BRAKE_ON:
+            return {ProfileKind::PARKING_BRAKE, 0, 0, 0};
+        case VehicleProperty::PERF_ODOMETER:
+            return {ProfileKind::ODOMETER, 0, 0, 0};
+        case VehicleProperty::FUEL_LEVEL:
+            return {ProfileKind::FUEL, 0, 0, 0};
+        case VehicleProperty::TIRE_PRESSURE:
+            // Slow leak or warm-up, a few kPa over minutes
+            return {ProfileKind::DRIFT, initial * 0.95f, initial * 1.02f, 0.05f};
+        case VehicleProperty::ENGINE_OIL_TEMP:
+        case VehicleProperty::ENV_OUTSIDE_TEMPERATURE:
+            return {ProfileKind::DRIFT, initial - 5.0f, initial + 5.0f, 0.1f};
+        default:
+            break;
+    }
+
+    const VehiclePropertyType type = getPropType(config.prop);
+    const VehicleAreaConfig* area = findAreaConfig(config, areaId);
+
+    if (config.changeMode == VehiclePropertyChangeMode::CONTINUOUS) {
+        if (area != nullptr && area->minFloatValue < area->maxFloatValue) {
+            return {ProfileKind::SINE, area->minFloatValue, area->maxFloatValue, 30.0f};
+        }
+        if (area != nullptr && area->minInt32Value < area->maxInt32Value) {
+            return {ProfileKind::SINE, float(area->minInt32Value), float(area->maxInt32Value), 30.0f};
+        }
+        if (type == VehiclePropertyType::FLOAT) {
+            return (initial != 0.0f) ? SignalProfile {ProfileKind::SINE, initial * 0.9f, initial * 1.1f, 30.0f}
+                                     : SignalProfile {ProfileKind::SINE, 0.0f, 10.0f, 30.0f};
+        }
+    } else if (config.changeMode == VehiclePropertyChangeMode::ON_CHANGE
+            && config.access == VehiclePropertyAccess::READ && type == VehiclePropertyType::BOOLEAN) {
+        // Staggered, so the toggles of different properties do not line up.
+        return {ProfileKind::SQUARE, initial, (initial != 0.0f) ? 0.0f : 1.0f,
+                60.0f + (config.prop & 0xf) * 10.0f};
+    }
+
+    return {ProfileKind::CONSTANT, initial, initial, 0};
+}
+
+bool parseProfile(const std::string& spec, SignalProfile* profile)
+{
+    static const struct {
+        const char*     name;
+        ProfileKind     kind;
+        size_t          params;
+    } kProfiles[] = {
+        {"const", ProfileKind::CONSTANT, 1},
+        {"sine", ProfileKind::SINE, 3},
+        {"ramp", ProfileKind::RAMP, 3},
+        {"square", ProfileKind::SQUARE, 3},
+        {"drift", ProfileKind::DRIFT, 3},
+        {"speed", ProfileKind::SPEED, 0},
+        {"rpm", ProfileKind::RPM, 0},
+        {"gear", ProfileKind::GEAR, 0},
+        {"gear_selection", ProfileKind::GEAR_SELECTION, 0},
+        {"parking_brake", ProfileKind::PARKING_BRAKE, 0},
+        {"odometer", ProfileKind::ODOMETER, 0},
+        {"fuel", ProfileKind::FUEL, 0},
+    };
+
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (size_t colon; (colon = spec.find(':', start)) != std::string::npos; start = colon + 1) {
+        fields.push_back(spec.substr(start, colon - start));
+    }
+    fields.push_back(spec.substr(start));
+
+    float params[3] = {};
+    for (size_t i = 1; i < fields.size() && i <= 3; i++) {
+        char* end = nullptr;
+        params[i - 1] = strtof(fields[i].c_str(), &end);
+        if (end == fields[i].c_str() || *end != '\0') {
+            return false;
+        }
+    }
+
+    for (auto& it : kProfiles) {
+        if (fields[0] != it.name) {
+            continue;
+        }
+        if (fields.size() != it.params + 1) {
+            return false;
+        }
+        *profile = {it.kind, params[0], params[1], params[2]};
+        if (it.kind == ProfileKind::CONSTANT) {
+            profile->high = profile->low;
+        }
+        // Periods and steps must be positive, ranges may run either way.
+        return it.params < 3 || profile->period > 0;
+    }
+    return false;
+}
+
+SignalGenerator::SignalGenerator(const SignalProfile& profile, float initial, uint32_t seed) :
+    mProfile(profile),
+    mInitial(initial),
+    mValue(initial),
+    mLastTime(0),
+    mRandom(seed)
+{
+    if (mProfile.kind == ProfileKind::DRIFT) {
+        mValue = std::min(std::max(mValue, std::min(mProfile.low, mProfile.high)),
+                          std::max(mProfile.low, mProfile.high));
+    }
+}
+
+void SignalGenerator::hold(float value)
+{
+    mProfile = {ProfileKind::CONSTANT, value, value, 0};
+    mValue = value;
+}
+
+float SignalGenerator::next(double t, const DriveCycle& cycle)
+{
+    const float range = mProfile.high - mProfile.low;
+    const double elapsed = t - mLastTime;
+    mLastTime = t;
+
+    switch (mProfile.kind) {
+        case ProfileKind::CONSTANT:
+            mValue = mProfile.low;
+            break;
+        case ProfileKind::SINE:
+            mValue = mProfile.low + range * 0.5f * (1.0f + std::sin(2 * M_PI * t / mProfile.period));
+            break;
+        case ProfileKind::RAMP:
+            mValue = mProfile.low + range * std::fmod(t, mProfile.period) / mProfile.period;
+            break;
+        case ProfileKind::SQUARE:
+            mValue = (std::fmod(t, mProfile.period) < mProfile.period / 2) ? mProfile.low : mProfile.high;
+            break;
+        case ProfileKind::DRIFT: {
+            std::uniform_real_distribution<float> step(-mProfile.period, mProfile.period);
+            mValue += step(mRandom) * elapsed;
+            mValue = std::min(std::max(mValue, std::min(mProfile.low, mProfile.high)),
+                              std::max(mProfile.low, mProfile.high));
+            break;
+        }
+        case ProfileKind::SPEED:
+            mValue = cycle.speed();
+            break;
+        case ProfileKind::RPM:
+            mValue = cycle.rpm();
+            break;
+        case ProfileKind::GEAR:
+            mValue = cycle.gear();
+            break;
+        case ProfileKind::GEAR_SELECTION:
+            mValue = cycle.gearSelection();
+            break;
+        case ProfileKind::PARKING_BRAKE:
+            mValue = cycle.isParked() ? 1.0f : 0.0f;
+            break;
+        case ProfileKind::ODOMETER:
+            mValue = mInitial + cycle.distance() / 1000.0;
+            break;
+        case ProfileKind::FUEL:
+            mValue = std::max(0.0, mInitial - cycle.distance() / 1000.0 * kFuelPerKm);
+            break;
+    }
+    return mValue;
+}
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
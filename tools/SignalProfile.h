@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2019 GlobalLogic
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SignalProfile_H_
+#define _SignalProfile_H_
+
+#include <random>
+#include <string>
+
+#include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace renesas {
+
+/*
+ * A car driving laps: parked, pulling away through the gears, cruising,
+ * braking to a stop, and parked again every few laps. The powertrain
+ * profiles below follow it, so speed, RPM, gear and odometer agree.
+ */
+class DriveCycle {
+public:
+    explicit DriveCycle(uint32_t seed = 1);
+
+    void advance(double seconds);
+
+    float speed(void) const { return mSpeed; }              // m/s
+    float rpm(void) const;
+    int32_t gear(void) const;                               // VehicleGear, CURRENT_GEAR
+    int32_t gearSelection(void) const;                      // VehicleGear, GEAR_SELECTION
+    bool isParked(void) const { return mPhase == Phase::PARKED; }
+    double distance(void) const { return mDistance; }       // m since start
+
+private:
+    enum class Phase {
+        PARKED,
+        ACCELERATE,
+        CRUISE,
+        BRAKE,
+        STOPPED,
+    };
+
+    void enter(Phase phase);
+
+    std::mt19937    mRandom;
+    Phase           mPhase;
+    double          mPhaseLeft;     // s, for the timed phases
+    float           mSpeed;
+    float           mTargetSpeed;
+    double          mDistance;
+    unsigned        mLaps;
+};
+
+enum class ProfileKind {
+    CONSTANT,       // low
+    SINE,           // low..high, period s
+    RAMP,           // low..high sawtooth, period s
+    SQUARE,         // low, then high, period s
+    DRIFT,          // random walk within low..high, at most step units per second
+    SPEED,          // DriveCycle::speed()
+    RPM,
+    GEAR,
+    GEAR_SELECTION,
+    PARKING_BRAKE,
+    ODOMETER,       // initial value + distance driven, km
+    FUEL,           // initial value - fuel burnt, ml
+};
+
+struct SignalProfile {
+    ProfileKind kind;
+    float       low;
+    float       high;
+    float       period;     // s, or the DRIFT step
+};
+
+/*
+ * Profile of one (property, area) when the command line does not set one:
+ * the drive cycle for the powertrain properties, slow drift for pressures
+ * and temperatures, a sweep of the area range for other continuous
+ * properties, a slow toggle for read-only booleans and the initial value
+ * for everything else.
+ */
+SignalProfile defaultProfile(const VehiclePropConfig& config, int32_t areaId, float initial);
+
+/*
+ * Parses "const:<v>", "sine|ramp|square:<low>:<high>:<period s>",
+ * "drift:<low>:<high>:<step per s>" or one of "speed", "rpm", "gear",
+ * "gear_selection", "parking_brake", "odometer", "fuel".
+ */
+bool parseProfile(const std::string& spec, SignalProfile* profile);
+
+/* Values of one profile over time. */
+class SignalGenerator {
+public:
+    SignalGenerator(const SignalProfile& profile, float initial, uint32_t seed);
+
+    /* Value at t seconds since start. */
+    float next(double t, const DriveCycle& cycle);
+
+    /* Holds value from now on, as an ECU does with a value it was told to set. */
+    void hold(float value);
+
+private:
+    SignalProfile       mProfile;
+    const float         mInitial;
+    float               mValue;
+    double              mLastTime;
+    std::mt19937        mRandom;
+};
+
+}  // namespace renesas
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif // _SignalProfile_H_